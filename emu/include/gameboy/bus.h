@@ -4,6 +4,7 @@
 #include <string>
 #include <array>
 #include <memory>
+#include <type_traits>
 
 class Timer; // Forward declaration
 class ROM; // Forward declaration
@@ -27,25 +28,92 @@ class Bus
             void (Bus::*write_fn)(uint16_t, uint8_t);
         };
         
-        static constexpr size_t NUM_REGIONS = 9;
+        static constexpr size_t NUM_REGIONS = 8;
         std::array<MemoryRegion, NUM_REGIONS> memory_regions;
-        
+
+        // Page table, one entry per 256-byte page: a host pointer for plain memory, nullptr falls back to memory_regions
+        static constexpr size_t NUM_PAGES = 256;
+        std::array<const uint8_t*, NUM_PAGES> read_pages = {};
+        std::array<uint8_t*, NUM_PAGES> write_pages = {};
+        uint8_t* vram_pages = nullptr; // Host VRAM while unlocked, only bulk stores write through it
+        uint8_t* bulk_write_page(uint8_t page) const;
+
+        // I/O register dispatch (0xFF00-0xFF7F), one entry per register, filled in by each component through map_io
+        // Registers without a handler read and write the plain io[] storage
+        struct IoHandler {
+            void* owner = nullptr;
+            uint8_t (*read_fn)(void*, uint16_t) = nullptr;
+            void (*write_fn)(void*, uint16_t, uint8_t) = nullptr;
+        };
+        std::array<IoHandler, MemoryMap::IO_SIZE> io_handlers = {};
+
         void init_memory_table();
+        void init_io_table();
+        uint8_t bus_read_slow(uint16_t address);
+        void bus_write_slow(uint16_t address, uint8_t data);
         uint8_t rom_read(uint16_t address);
         void rom_write(uint16_t address, uint8_t value);
         uint8_t hram_read(uint16_t address);
         void hram_write(uint16_t address, uint8_t value);
-        uint8_t lcd_read(uint16_t address);
-        void lcd_write(uint16_t address, uint8_t value);
         uint8_t audio_read(uint16_t address);
         void audio_write(uint16_t address, uint8_t value);
+        uint8_t if_read(uint16_t address);
+        void if_write(uint16_t address, uint8_t value);
+        void bootrom_disable_write(uint16_t address, uint8_t value);
         
     public:
         Bus();
         // Set component pointers
         void set_cmp(ROM* rom_ptr, Timer* timer_ptr, Ppu* ppu_ptr, DMA* dma_ptr, LCD* lcd_ptr) { rom = rom_ptr; timer = timer_ptr; ppu = ppu_ptr; dma = dma_ptr; lcd = lcd_ptr; }
-        uint8_t bus_read(uint16_t address);
-        void bus_write(uint16_t address, uint8_t data);
+        // Plain memory is a single table lookup, MMIO and locked regions go through the region handlers
+        inline uint8_t bus_read(uint16_t address)
+        {
+            #ifdef OPCODE_TEST
+                return opcode_test_mem[address];
+            #endif
+            const uint8_t* page = read_pages[address >> 8];
+            if (page)
+                return page[address & 0xFF];
+            return bus_read_slow(address);
+        }
+        inline void bus_write(uint16_t address, uint8_t data)
+        {
+            #ifdef OPCODE_TEST
+                opcode_test_mem[address] = data;
+                return;
+            #endif
+            uint8_t* page = write_pages[address >> 8];
+            if (page)
+            {
+                page[address & 0xFF] = data;
+                return;
+            }
+            bus_write_slow(address, data);
+        }
+        // Route the I/O registers start..end to owner, either function may be nullptr to leave that direction on io[]
+        // Example: bus->map_io<&Timer::read, &Timer::write>(0xFF04, 0xFF07, this);
+        template <auto ReadFn, auto WriteFn, typename T>
+        void map_io(uint16_t start, uint16_t end, T* owner)
+        {
+            for (uint16_t address = start; address <= end; address++) {
+                IoHandler& handler = io_handlers[address - MemoryMap::IO_START];
+                handler.owner = owner;
+                if constexpr (!std::is_null_pointer_v<decltype(ReadFn)>)
+                    handler.read_fn = [](void* obj, uint16_t addr) -> uint8_t { return (static_cast<T*>(obj)->*ReadFn)(addr); };
+                if constexpr (!std::is_null_pointer_v<decltype(WriteFn)>)
+                    handler.write_fn = [](void* obj, uint16_t addr, uint8_t value) { (static_cast<T*>(obj)->*WriteFn)(addr, value); };
+            }
+        }
+        // Rebuild page table entries, call after the ROM mapping or the VRAM lock state changes
+        void init_page_table();
+        void map_rom_pages();
+        void map_vram_pages();
+        // count bytes stored forward one at a time, as a CPU copy/fill loop would, straight on the host pages.
+        // Return false without touching memory if a page in either range is not plain memory
+        bool bulk_copy(uint16_t dst, uint16_t src, uint32_t count);
+        bool bulk_fill(uint16_t dst, uint8_t value, uint32_t count);
+        uint32_t rom_map_generation = 0; // Bumped by map_rom_pages when a ROM page moves, code decoded from ROM is stale once it changes
+        int rom_bank(uint16_t address); // ROM bank mapped at a 0x0000-0x7FFF address, -1 for the bootrom or no cartridge
         void exram_write(uint16_t address, uint8_t value);
         void echoram_write(uint16_t address, uint8_t value);
         void wram_write(uint16_t address, uint8_t value);
@@ -66,7 +134,6 @@ class Bus
         uint8_t if_register = 0; // Interrupt Flag register (0xFF0F)
         uint8_t audio_regs[MemoryMap::AUDIO_SIZE] = {}; // Audio registers (0xFF10-0xFF26)
         uint8_t wave_ram[MemoryMap::WAVE_RAM_SIZE] = {}; // Wave Pattern RAM (0xFF30-0xFF3F)
-        std::string serial_buffer = "";
 
         std::unique_ptr<uint8_t[]> opcode_test_mem = std::make_unique<uint8_t[]>(64*1024); // 64KB flat memory for opcode tests
         bool test_mode = false; // Flag to indicate if in test mode
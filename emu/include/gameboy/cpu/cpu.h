@@ -1,8 +1,13 @@
 #pragma once
 #include <cstdint>
+#include <array>
+#include <bit>
+#include <cstddef>
 #include "cpu_types.h"
 #include <interrupts.h>
 #include "cpu_tables.h"
+#include "cpu_block_cache.h"
+#include "cpu_jit.h"
 class Ppu; 
 
 struct Opcode
@@ -11,27 +16,71 @@ struct Opcode
     uint8_t x;
     uint8_t y;
     uint8_t z;
-    Opcode(uint8_t op) : whole(op), x((op >> 6) & 0x03), y((op >> 3) & 0x07), z(op & 0x07) {}
-    Opcode() : whole(0), x(0), y(0), z(0) {}
+    constexpr Opcode(uint8_t op) : whole(op), x((op >> 6) & 0x03), y((op >> 3) & 0x07), z(op & 0x07) {}
+    constexpr Opcode() : whole(0), x(0), y(0), z(0) {}
 };
 
+// Byte halves of a register pair in host memory order, so the pair and its bytes alias through a union
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CPU_REGISTER_PAIR(pair, high, low) union { uint16_t pair; struct { uint8_t high; uint8_t low; }; }
+#else
+#define CPU_REGISTER_PAIR(pair, high, low) union { uint16_t pair; struct { uint8_t low; uint8_t high; }; }
+#endif
+
 struct cpu_registers
 {
-    uint8_t a;
-    uint8_t f;
-    uint8_t b;
-    uint8_t c;
-    uint8_t d;
-    uint8_t e;
-    uint8_t h;
-    uint8_t l;
+    CPU_REGISTER_PAIR(af, a, f); // f is stale while a lazy flag update is pending, use Cpu::read_f/write_f from outside the CPU
+    CPU_REGISTER_PAIR(bc, b, c);
+    CPU_REGISTER_PAIR(de, d, e);
+    CPU_REGISTER_PAIR(hl, h, l);
     uint16_t pc;
     uint16_t sp;
 };
+static_assert((std::endian::native == std::endian::little) == (offsetof(cpu_registers, b) == offsetof(cpu_registers, bc) + 1),
+              "cpu_registers byte order does not match the host");
+
+// Polling loops fast-forwarded by cpu_run since the ROM was loaded
+struct idle_skip_stats
+{
+    uint64_t hits = 0;     // Times a loop was fast-forwarded
+    uint64_t t_cycles = 0; // Emulated time skipped
+};
+
+// Copy/fill loops run as host copies since the ROM was loaded
+struct bulk_loop_stats
+{
+    uint64_t hits = 0;  // Times a loop was run in bulk
+    uint64_t bytes = 0; // Bytes stored by those runs
+};
+
+// Superinstructions run by the block cache loop since the ROM was loaded
+struct fused_dispatch_stats
+{
+    uint64_t dispatches = 0;   // Fused sequences run
+    uint64_t instructions = 0; // Instructions they covered, each would have been a dispatch of its own
+};
+
+// Register-only runs executed as translated x86-64 code since the ROM was loaded (GAMEBOY_JIT builds)
+struct native_dispatch_stats
+{
+    uint64_t runs = 0;         // Translated runs executed
+    uint64_t instructions = 0; // Instructions they covered
+};
+
+// Last flag-setting ALU operation and its operands
+struct lazy_flags
+{
+    FlagOp op = FlagOp::NONE;
+    uint8_t lhs = 0;
+    uint8_t rhs = 0;
+    uint8_t carry = 0; // Carry in (ADC/SBC), carry out (SHIFT) or the preserved C flag (INC/DEC)
+    uint8_t result = 0; // Every lazy op sets Z from the 8-bit result
+};
 
 class Bus; // Forward declaration
 class Timer; // Forward declaration
 class DMA; // Forward declaration
+class Scheduler; // Forward declaration
 
 class Cpu
 {
@@ -40,71 +89,192 @@ class Cpu
         Timer* timer;
         DMA* dma;
         Ppu* ppu;
-        // Helper methods for instruction tables
-        uint8_t* get_r8_ptr(R8 reg);
-        uint8_t read_r8(R8 reg);
-        void write_r8(R8 reg, uint8_t value);
-        
-        uint16_t get_r16_group1(R16_Group1 reg);
-        void set_r16_group1(R16_Group1 reg, uint16_t value);
-        
-        uint16_t get_r16_group2(R16_Group2 reg);
-        void set_r16_group2(R16_Group2 reg, uint16_t value);
-        
-        uint16_t get_r16_group3(R16_Group3 reg);
-        void set_r16_group3(R16_Group3 reg, uint16_t value);
-        
-        bool check_condition(ConditionCode cc);
-        void execute_acc_flag_op(AccFlagOp op);
-        void execute_alu_op(AluOp op, uint8_t operand);
-        void execute_shift_rotate_op(ShiftRotateOp op, R8 reg);
-        
+        Scheduler* scheduler;
+        using OpcodeHandler = uint8_t (Cpu::*)(); // Executes one instruction and returns the M-cycles it took
+        using OpcodeTable = std::array<OpcodeHandler, 256>;
+
+        // Register access with the operand fixed at compile time, (HL) goes through the bus
+        template <R8 REG> uint8_t read_r8()
+        {
+            if constexpr (REG == R8::B) return regs.b;
+            else if constexpr (REG == R8::C) return regs.c;
+            else if constexpr (REG == R8::D) return regs.d;
+            else if constexpr (REG == R8::E) return regs.e;
+            else if constexpr (REG == R8::H) return regs.h;
+            else if constexpr (REG == R8::L) return regs.l;
+            else if constexpr (REG == R8::HL_IND) return read_hl_ind();
+            else return regs.a;
+        }
+        template <R8 REG> void write_r8(uint8_t value)
+        {
+            if constexpr (REG == R8::B) regs.b = value;
+            else if constexpr (REG == R8::C) regs.c = value;
+            else if constexpr (REG == R8::D) regs.d = value;
+            else if constexpr (REG == R8::E) regs.e = value;
+            else if constexpr (REG == R8::H) regs.h = value;
+            else if constexpr (REG == R8::L) regs.l = value;
+            else if constexpr (REG == R8::HL_IND) write_hl_ind(value);
+            else regs.a = value;
+        }
+        uint8_t read_hl_ind();
+        void write_hl_ind(uint8_t value);
+
+        // Pairs are single 16-bit loads and stores through the register unions
+        template <R16_Group1 REG> uint16_t& r16_group1()
+        {
+            if constexpr (REG == R16_Group1::BC) return regs.bc;
+            else if constexpr (REG == R16_Group1::DE) return regs.de;
+            else if constexpr (REG == R16_Group1::HL) return regs.hl;
+            else return regs.sp;
+        }
+        template <R16_Group1 REG> uint16_t get_r16_group1() { return r16_group1<REG>(); }
+        template <R16_Group1 REG> void set_r16_group1(uint16_t value) { r16_group1<REG>() = value; }
+        // BC, DE, HL+ and HL-, the HL forms post-increment/decrement HL
+        template <R16_Group2 REG> uint16_t get_r16_group2()
+        {
+            if constexpr (REG == R16_Group2::BC) return regs.bc;
+            else if constexpr (REG == R16_Group2::DE) return regs.de;
+            else if constexpr (REG == R16_Group2::HL_INC) return regs.hl++;
+            else return regs.hl--;
+        }
+        template <R16_Group3 REG> uint16_t get_r16_group3()
+        {
+            if constexpr (REG == R16_Group3::AF) return (static_cast<uint16_t>(regs.a) << 8) | read_f();
+            else return get_r16_group1<static_cast<R16_Group1>(REG)>();
+        }
+        template <R16_Group3 REG> void set_r16_group3(uint16_t value)
+        {
+            if constexpr (REG == R16_Group3::AF)
+            {
+                write_f(value & 0xF0); // Mask lower 4 bits of F
+                regs.a = static_cast<uint8_t>(value >> 8);
+            }
+            else set_r16_group1<static_cast<R16_Group1>(REG)>(value);
+        }
+
+        template <ConditionCode CC> bool check_condition()
+        {
+            if constexpr (CC == ConditionCode::NZ) return !get_flag_z(); // Zero flag not set
+            else if constexpr (CC == ConditionCode::Z) return get_flag_z(); // Zero flag set
+            else if constexpr (CC == ConditionCode::NC) return !get_flag_c(); // Carry flag not set
+            else return get_flag_c(); // Carry flag set
+        }
+        // ALU helpers, explicitly instantiated for every op in cpu_alu.cpp
+        template <AccFlagOp OP> void execute_acc_flag_op();
+        template <AluOp OP> void execute_alu_op(uint8_t operand);
+        template <ShiftRotateOp OP> uint8_t execute_shift_rotate_op(uint8_t value);
+
         // Immediate data reading helpers
         uint8_t read_imm8();
         uint16_t read_imm16();
         int8_t read_imm_signed8();
+        // FETCH = false for handlers run from the block cache, which has already set fetched_data and PC
+        template <uint8_t OP, bool FETCH> void fetch_data()
+        {
+            constexpr int imm_size = INSTRUCTION_TABLE[OP].imm_size;
+            static_assert(INSTRUCTION_TABLE[OP].length == 1 + imm_size || OP == 0x10, "INSTRUCTION_TABLE length and imm_size disagree"); // STOP has a padding byte
+            if constexpr (!FETCH)
+                return;
+            else if constexpr (imm_size == 1)
+                fetched_data = read_imm8();
+            else if constexpr (imm_size == 2)
+                fetched_data = read_imm16();
+        }
         
-        // Flag manipulation helpers
-        void set_flag_z(bool value);
-        void set_flag_n(bool value);
-        void set_flag_h(bool value);
-        void set_flag_c(bool value);
-        bool get_flag_z() const;
-        bool get_flag_n() const;
-        bool get_flag_h() const;
-        bool get_flag_c() const;
-        void set_flags_dec(uint8_t result, uint8_t original);
-        void set_flags_inc(uint8_t result, uint8_t original);
+        // Flag manipulation helpers, the ALU ops only record what they did and F is computed on the first read
+        lazy_flags pending_flags;
+        uint8_t compute_f() const;
+        void defer_flags(FlagOp op, uint8_t lhs, uint8_t rhs, uint8_t carry, uint8_t result) { pending_flags = {op, lhs, rhs, carry, result}; }
+        // Single flag updates apply on top of the materialized F
+        void set_flag(alu_flags flag, bool value)
+        {
+            regs.f = (read_f() & ~static_cast<uint8_t>(flag)) | (value ? static_cast<uint8_t>(flag) : 0);
+            pending_flags.op = FlagOp::NONE;
+        }
+        void set_flag_z(bool value) { set_flag(alu_flags::Z, value); }
+        void set_flag_n(bool value) { set_flag(alu_flags::N, value); }
+        void set_flag_h(bool value) { set_flag(alu_flags::H, value); }
+        void set_flag_c(bool value) { set_flag(alu_flags::C, value); }
+        bool get_flag_z() const { return pending_flags.op == FlagOp::NONE ? (regs.f & 0x80) : pending_flags.result == 0; }
+        bool get_flag_n() const { return read_f() & 0x40; }
+        bool get_flag_h() const { return read_f() & 0x20; }
+        // C alone from the pending op, without building the rest of F: INC/DEC carry it forward on every call
+        bool get_flag_c() const
+        {
+            const lazy_flags& lf = pending_flags;
+            switch (lf.op) {
+                case FlagOp::NONE: return regs.f & 0x10;
+                case FlagOp::ADD: case FlagOp::ADC: return lf.lhs + lf.rhs + lf.carry > 0xFF; // Carry in is 0 for ADD
+                case FlagOp::SUB: case FlagOp::SBC: return lf.lhs < lf.rhs + lf.carry;        // Borrow, 0 carry in for SUB
+                case FlagOp::AND: case FlagOp::LOGIC: return false;
+                default: return lf.carry; // INC/DEC keep it, SHIFT shifted it out
+            }
+        }
+        void set_flags_dec(uint8_t result, uint8_t original) { defer_flags(FlagOp::DEC, original, 1, get_flag_c(), result); }
+        void set_flags_inc(uint8_t result, uint8_t original) { defer_flags(FlagOp::INC, original, 1, get_flag_c(), result); }
         
         // Stack operations
         void stack_push8(uint8_t value);
         void stack_push16(uint16_t value);
         uint8_t stack_pop8();
         uint16_t stack_pop16();
-        
-        // Instruction group handlers
-        void execute_x0_instructions();
-        void execute_x1_instructions();
-        void execute_x2_instructions();
-        void execute_x3_instructions();
-        void execute_cb_instructions();
-        
-        // Specific instruction handlers
-        void handle_ld_r16_imm16();
-        void handle_ld_r8_r8();
-        void handle_inc_r8();
-        void handle_dec_r8();
-        void handle_ld_r8_imm8();
-        void handle_inc_r16();
-        void handle_dec_r16();
-        void handle_ld_indirect();
-        void handle_alu_r8();
-        void handle_alu_imm8();
-        void handle_jp_and_interrupts();
-        void handle_ret_conditional();
-        void handle_pop_r16();
-        void handle_push_r16();
-        void handle_call_conditional();
+
+        // One handler per opcode, OP is decoded at compile time so operand selection folds away
+        template <uint8_t OP, bool FETCH> uint8_t execute_x0(); // 0x00-0x3F
+        template <uint8_t OP, bool FETCH> uint8_t execute_x1(); // 0x40-0x7F
+        template <uint8_t OP, bool FETCH> uint8_t execute_x2(); // 0x80-0xBF
+        template <uint8_t OP, bool FETCH> uint8_t execute_x3(); // 0xC0-0xFF
+        template <uint8_t OP> uint8_t execute_cb(); // 0xCB 0x00-0xFF
+        // Handler for an opcode known at compile time, a direct call to the instantiation OPCODE_TABLE/DECODED_TABLE holds
+        template <uint8_t OP, bool FETCH> uint8_t execute_opcode()
+        {
+            if constexpr (OP < 0x40) return execute_x0<OP, FETCH>();
+            else if constexpr (OP < 0x80) return execute_x1<OP, FETCH>();
+            else if constexpr (OP < 0xC0) return execute_x2<OP, FETCH>();
+            else return execute_x3<OP, FETCH>();
+        }
+        // Each group file fills its own range of both tables with its instantiations
+        static void fill_x0_handlers(OpcodeTable& table, OpcodeTable& decoded_table);
+        static void fill_x1_handlers(OpcodeTable& table, OpcodeTable& decoded_table);
+        static void fill_x2_handlers(OpcodeTable& table, OpcodeTable& decoded_table);
+        static void fill_x3_handlers(OpcodeTable& table, OpcodeTable& decoded_table);
+        static void fill_cb_handlers(OpcodeTable& table);
+        static OpcodeTable build_opcode_table(bool fetch);
+        static OpcodeTable build_cb_table();
+        static const OpcodeTable OPCODE_TABLE;  // Handlers that fetch their own immediate
+        static const OpcodeTable DECODED_TABLE; // Handlers for the block cache, immediate and PC already set
+        static const OpcodeTable CB_TABLE;
+
+        // Basic blocks decoded from ROM, run by cpu_run
+        BlockCache block_cache;
+        DecodedBlock* find_block(uint16_t pc);
+        void decode_block(uint16_t pc, DecodedBlock& block);
+        uint64_t run_block(const DecodedBlock& block, uint64_t frame_target);
+        bool run_micro_op(const MicroOp& op, uint32_t rom_map, uint64_t frame_target);
+        bool run_fused(const MicroOp& op, uint32_t rom_map, uint64_t frame_target); // Superinstruction starting at op
+        // One handler per FUSED_SEQUENCES entry, calling each member's handler directly
+        using FusedHandler = void (Cpu::*)(const MicroOp* ops);
+        using FusedTable = std::array<FusedHandler, std::size(FUSED_SEQUENCES)>;
+        template <std::size_t SEQ> void execute_fused(const MicroOp* ops);
+        static FusedTable build_fused_table();
+        static const FusedTable FUSED_TABLE;
+        // True if the next m_cycles can run with no per-instruction tail: no EI taking effect, no interrupt waiting
+        // and no event due before they end
+        bool can_batch(uint8_t m_cycles) const;
+#if GAMEBOY_JIT
+        Jit jit;
+        JitLayout jit_layout();
+        static uint8_t jit_read_carry(Cpu* cpu);
+        bool run_native(const MicroOp& op, uint32_t rom_map, uint64_t frame_target); // Translated run starting at op
+#endif
+        uint64_t run_idle_loop(const DecodedBlock& block, uint64_t frame_target); // Fast-forwards polling loops to the next event
+        // Copy/fill loops run as host copies up to the next event (cpu_bulk_loop.cpp)
+        static bool match_bulk_loop(const std::array<uint8_t, DecodedBlock::MAX_OPS>& opcodes, DecodedBlock& block);
+        uint64_t run_bulk_loop(const DecodedBlock& block, uint64_t frame_target);
+        uint64_t run_block_front_end(const DecodedBlock& block, uint64_t frame_target); // Idle, bulk or plain block
+
+        // Per-instruction tail shared by cpu_step and the cpu_run loops
+        void finish_step(bool enable_ime_after);
 
         bool check_interrupt(Interrupts::InterruptMask it);
         void handle_interrupts();
@@ -114,23 +284,29 @@ class Cpu
     public:
         Cpu();
         // Set component pointers
-        void set_cmp(Bus* bus_ptr, Timer* timer_ptr, DMA* dma_ptr, Ppu* ppu_ptr) { bus = bus_ptr; timer = timer_ptr; dma = dma_ptr; ppu = ppu_ptr; }
+        void set_cmp(Bus* bus_ptr, Timer* timer_ptr, DMA* dma_ptr, Ppu* ppu_ptr, Scheduler* scheduler_ptr) { bus = bus_ptr; timer = timer_ptr; dma = dma_ptr; ppu = ppu_ptr; scheduler = scheduler_ptr; }
         void cpu_init();
         bool cpu_step();
-        void fetch_data();
-        void fetch_instruction();
-        void execute_instruction();
-        void read_serial_debug();
+        // Run until the PPU has completed frame_target frames, returns the number of instructions executed
+        uint64_t cpu_run(uint64_t frame_target);
+        static const char* dispatch_mode(); // Fast paths and the loop outside ROM selected at build time
+        bool idle_skip = true; // Fast-forward idle polling loops in the block cache front end, in either cpu_run build
+        bool halt_skip = true; // Jump HALT straight to the next scheduled event instead of spinning one M-cycle at a time
+        idle_skip_stats idle_stats;
+        bulk_loop_stats bulk_stats;
+        fused_dispatch_stats fused_stats;
+        native_dispatch_stats native_stats;
         void emu_cycles(int m_cycles);
         void request_interrupt(Interrupts::InterruptMask it);
+        // F with any pending lazy flag update applied, and a write that drops the pending update
+        uint8_t read_f() const { return pending_flags.op == FlagOp::NONE ? regs.f : compute_f(); }
+        void write_f(uint8_t value) { regs.f = value; pending_flags.op = FlagOp::NONE; }
         cpu_registers regs;
         uint16_t fetched_data;
         uint16_t mem_dest;
-        Opcode opcode;
         bool halted;
         bool stepping;
         bool ime = 0; // Interrupt Master Enable flag
         bool ime_delay = 0;
-        bool branch_taken = false;
 };
 
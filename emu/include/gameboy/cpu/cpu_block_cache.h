@@ -0,0 +1,87 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "cpu_tables.h"
+#include "cpu_types.h"
+
+class Cpu;
+
+// One pre-decoded instruction, the handler runs with fetched_data and PC already set from here
+struct MicroOp
+{
+    uint8_t (Cpu::*handler)();
+    uint16_t imm;     // Immediate operand (or the CB opcode)
+    uint16_t next_pc; // PC after the instruction, anything else after it ran means a branch or an interrupt
+    uint8_t fused = 0;        // Length of the FUSED_SEQUENCES entry starting here, 0 if none
+    uint8_t fused_sequence = 0; // Index of that entry, selects its handler in Cpu::FUSED_TABLE
+    uint8_t fused_cycles = 0; // Most M-cycles that sequence can take (branches taken)
+#if GAMEBOY_JIT
+    using NativeFn = void (*)(Cpu*);
+    NativeFn native = nullptr;  // x86-64 code for the register-only run starting here, see Jit
+    uint8_t native_count = 0;   // Instructions in that run
+    uint8_t native_cycles = 0;  // M-cycles they take, charged once after the run
+#endif
+};
+
+// Memory read by an idle loop, resolved against the registers when the loop is checked
+struct IdlePoll
+{
+    PollSource source;
+    uint16_t imm; // Address or I/O offset for the immediate forms
+};
+
+// Where a recognized copy/fill loop gets the byte it stores
+enum class BulkSource : uint8_t
+{
+    NONE,   // Not a copy/fill loop
+    MEMORY, // LD A, (src) copy
+    IMM8,   // LD A, u8 fill
+    ZERO,   // XOR A fill
+    A       // Fill with A as it was on entry
+};
+
+// [load] / store / pointer increments / DEC counter / JR NZ loop, see Cpu::match_bulk_loop
+struct BulkLoop
+{
+    BulkSource source = BulkSource::NONE;
+    R16_Group1 src = R16_Group1::HL; // Pointer read from (MEMORY only)
+    R16_Group1 dst = R16_Group1::HL; // Pointer stored to
+    bool wide_counter = false;       // DEC BC/DE, LD A, hi, OR lo instead of DEC r8
+    R16_Group1 counter_pair = R16_Group1::BC;
+    R8 counter = R8::B;
+    uint8_t imm = 0;
+    uint16_t iteration_cycles = 0;   // T-cycles of one iteration with the branch taken
+};
+
+// Straight-line run of ROM instructions, ending at the first jump/call/return, HALT/STOP or the bank boundary
+struct DecodedBlock
+{
+    static constexpr int MAX_OPS = 32;
+    uint8_t count = 0; // 0 if the first instruction can't be cached (it straddles the bank boundary)
+    std::array<MicroOp, MAX_OPS> ops = {};
+    // Set when the block branches back to its own start and idle_loop_source accepts every other instruction
+    static constexpr int MAX_POLLS = 4;
+    bool idle_loop = false;
+    uint8_t poll_count = 0;
+    std::array<IdlePoll, MAX_POLLS> polls = {};
+    BulkLoop bulk; // Set when the block is a canonical memcpy/memset loop
+};
+
+// Decoded blocks keyed by (ROM bank, PC), ROM never changes so blocks stay valid for the whole run
+class BlockCache
+{
+    public:
+        static constexpr uint16_t BANK_SIZE = 0x4000;
+        // Block starting at pc in bank, nullptr if it hasn't been decoded yet
+        DecodedBlock* find(uint16_t bank, uint16_t pc);
+        // Storage for a new block starting at pc in bank, filled in by the CPU
+        DecodedBlock& insert(uint16_t bank, uint16_t pc);
+
+    private:
+        using BankIndex = std::array<int32_t, BANK_SIZE>; // Index into blocks per offset in the bank, -1 if not decoded
+        std::vector<std::unique_ptr<BankIndex>> banks;
+        std::deque<DecodedBlock> blocks; // deque so references stay valid as it grows
+};
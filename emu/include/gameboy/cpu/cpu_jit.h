@@ -0,0 +1,51 @@
+#pragma once
+#if GAMEBOY_JIT
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "cpu_block_cache.h"
+
+class Cpu;
+
+// Where the translated code finds the CPU state, as byte offsets from the Cpu object it is called with
+struct JitLayout
+{
+    std::array<int32_t, 8> r8 = {};  // Indexed by R8, the HL_IND slot is unused
+    std::array<int32_t, 4> r16 = {}; // Indexed by R16_Group1
+    int32_t flag_op = 0;             // lazy_flags fields
+    int32_t flag_lhs = 0;
+    int32_t flag_rhs = 0;
+    int32_t flag_carry = 0;
+    int32_t flag_result = 0;
+    uint8_t (*read_carry)(Cpu*) = nullptr; // C with any pending flag update applied, 0 or 1
+};
+
+// x86-64 translation of register-only code in decoded ROM blocks (GAMEBOY_JIT builds only).
+// Every run of two or more instructions that touch nothing but registers and flags (LD, INC/DEC, 8-bit ALU with
+// register or immediate operands) becomes one native function. It stores the results and the lazy flag record
+// exactly as the handlers would, and Cpu::run_native charges the whole run's cycles once when it returns.
+// Memory accesses, branches, stack and CB ops stay on the handlers, so nothing inside a run reads the master clock.
+// A translation lives as long as its DecodedBlock: blocks are keyed by (bank, PC) and only ROM is decoded, so a bank
+// switch selects other blocks and code in RAM is never translated
+class Jit
+{
+    public:
+        static constexpr int MIN_RUN = 2; // Shorter runs are left to the handlers and superinstructions
+
+        explicit Jit(const JitLayout& layout);
+        ~Jit();
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+        // Translate the register-only runs of a freshly decoded block into block.ops[i].native. Runs stay on the
+        // handlers once the code buffer is full or if it could not be mapped
+        void translate(const std::array<uint8_t, DecodedBlock::MAX_OPS>& opcodes, DecodedBlock& block);
+        uint64_t code_bytes() const { return used; }
+
+    private:
+        static constexpr size_t CODE_SIZE = 16 * 1024 * 1024;
+        JitLayout layout;
+        uint8_t* code = nullptr;
+        size_t used = 0;
+        MicroOp::NativeFn emit_run(const uint8_t* opcodes, const MicroOp* ops, int count);
+};
+#endif
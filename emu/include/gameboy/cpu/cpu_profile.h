@@ -0,0 +1,30 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Counts adjacent instructions on the straight-line path (each one starts where INSTRUCTION_TABLE says the previous
+// one ended), to pick the sequences worth fusing into superinstructions. Fed from outside the CPU loop, one call
+// per instruction, so it costs nothing when unused: see --profile in the headless runner
+class OpcodeProfiler
+{
+    public:
+        struct Sequence
+        {
+            uint32_t opcodes; // 0xAABB for a pair, 0xAABBCC for a triple, first opcode in the top byte
+            uint64_t count;
+        };
+        void record(uint16_t pc, uint8_t opcode); // Instruction at pc is about to run
+        std::vector<Sequence> top_pairs(std::size_t n) const;
+        std::vector<Sequence> top_triples(std::size_t n) const;
+        uint64_t instructions = 0;
+
+    private:
+        std::array<uint64_t, 0x10000> pairs = {};
+        std::unordered_map<uint32_t, uint64_t> triples;
+        uint16_t expected_pc = 0;
+        int run = 0; // Adjacent instructions right before this one, capped at 2
+        std::array<uint8_t, 2> previous = {};
+};
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <iterator>
 
 // Instruction metadata for cycle timing and length
 struct InstructionInfo {
@@ -11,7 +13,7 @@ struct InstructionInfo {
 
 
 // Static instruction metadata table - defines length, m cycles, and immediate data for each opcode
-const InstructionInfo INSTRUCTION_TABLE[256] = {
+constexpr InstructionInfo INSTRUCTION_TABLE[256] = {
     // 0x00-0x0F
     {1, 1, 0, 0},  // 0x00 NOP
     {3, 3, 0, 2},  // 0x01 LD BC, u16
@@ -190,4 +192,185 @@ const InstructionInfo INSTRUCTION_TABLE[256] = {
     {1, 1, 0, 0},   // 0xFD -
     {2, 2, 0, 1},   // 0xFE CP A, u8
     {1, 4, 0, 0}   // 0xFF RST 0x38
-};
\ No newline at end of file
+};
+
+// M-cycles of a CB-prefixed instruction including the prefix: 2 for registers,
+// (HL) adds a read (BIT) or a read and a write (everything else)
+constexpr char cb_instruction_cycles(uint8_t cb_opcode)
+{
+    if ((cb_opcode & 0x07) != 6)
+        return 2;
+    return (cb_opcode >> 6) == 1 ? 3 : 4;
+}
+
+// True for instructions that may leave the straight-line path: JR/JP/CALL/RET/RETI/RST (conditional or not), HALT and STOP
+constexpr bool ends_basic_block(uint8_t opcode)
+{
+    switch (opcode)
+    {
+        case 0x10: case 0x76: // STOP, HALT
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9: // JP
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: // CALL
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9: // RET, RETI
+            return true;
+        default:
+            return (opcode & 0xC7) == 0xC7; // RST
+    }
+}
+
+// Memory operand of an instruction inside an idle loop, INVALID for instructions that can't be part of one
+enum class PollSource : uint8_t
+{
+    NONE,    // Registers only
+    BC,      // (BC)
+    DE,      // (DE)
+    HL,      // (HL)
+    IO_C,    // (0xFF00+C)
+    IO_IMM8, // (0xFF00+u8)
+    IMM16,   // (u16)
+    INVALID
+};
+
+// An idle loop body may only change A and F: no stores, no stack, no other register and no IME change,
+// so once A and F repeat, every iteration repeats until something it reads changes
+constexpr PollSource idle_loop_source(uint8_t opcode, uint8_t cb_opcode)
+{
+    if (opcode == 0xCB)
+    {
+        if ((cb_opcode >> 6) == 1) // BIT n, r
+            return (cb_opcode & 0x07) == 6 ? PollSource::HL : PollSource::NONE;
+        return ((cb_opcode >> 6) == 0 && (cb_opcode & 0x07) == 7) ? PollSource::NONE : PollSource::INVALID; // Rotate/shift/swap A
+    }
+    if (opcode >= 0x78 && opcode <= 0xBF) // LD A, r and ALU A, r
+        return (opcode & 0x07) == 6 ? PollSource::HL : PollSource::NONE;
+    if ((opcode & 0xC7) == 0xC6) // ALU A, u8
+        return PollSource::NONE;
+    switch (opcode)
+    {
+        case 0x00: case 0x3C: case 0x3D: case 0x3E: // NOP, INC A, DEC A, LD A, u8
+        case 0x07: case 0x0F: case 0x17: case 0x1F: case 0x27: case 0x2F: case 0x37: case 0x3F: // RLCA..CCF
+            return PollSource::NONE;
+        case 0x0A: return PollSource::BC;      // LD A, (BC)
+        case 0x1A: return PollSource::DE;      // LD A, (DE)
+        case 0xF0: return PollSource::IO_IMM8; // LDH A, (u8)
+        case 0xF2: return PollSource::IO_C;    // LD A, (0xFF00+C)
+        case 0xFA: return PollSource::IMM16;   // LD A, (u16)
+        default: return PollSource::INVALID;
+    }
+}
+
+// True if opcode reads and writes nothing but registers and flags: LD between registers or from an immediate,
+// 8/16-bit INC/DEC and the 8-bit ALU ops on a register or immediate. These are what the x86-64 translator lowers
+constexpr bool register_only(uint8_t opcode)
+{
+    uint8_t x = opcode >> 6;
+    uint8_t y = (opcode >> 3) & 0x07;
+    uint8_t z = opcode & 0x07;
+    switch (x)
+    {
+        case 0:
+            if (opcode == 0x00)
+                return true; // NOP
+            if (z == 1)
+                return (y & 1) == 0; // LD r16, u16 (ADD HL, r16 sets H/C through set_flag)
+            if (z == 3)
+                return true; // INC/DEC r16
+            return (z == 4 || z == 5 || z == 6) && y != 6; // INC/DEC r8, LD r8, u8
+        case 1:
+            return y != 6 && z != 6; // LD r8, r8
+        case 2:
+            return z != 6; // ALU A, r8
+        default:
+            return z == 6; // ALU A, u8
+    }
+}
+
+// True if opcode can run straight into the next instruction with no per-instruction tail in between, as long as no
+// scheduled event fires and no interrupt is pending: it does not store to memory (IE/IF, MBC and serial writes act at
+// the boundary), change IME, halt or branch. CB instructions are left out, their (HL) forms store
+constexpr bool fusable_lead(uint8_t opcode)
+{
+    switch (opcode)
+    {
+        case 0x02: case 0x12: case 0x22: case 0x32: case 0x08: // LD (r16), A / LD (u16), SP
+        case 0x34: case 0x35: case 0x36: // INC/DEC/LD (HL)
+        case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x77: // LD (HL), r
+        case 0xE0: case 0xE2: case 0xEA: // LDH (u8), A / LD (C), A / LD (u16), A
+        case 0xC5: case 0xD5: case 0xE5: case 0xF5: // PUSH
+        case 0xCB: case 0xF3: case 0xFB: // CB prefix, DI, EI
+        case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+            return false;
+        default:
+            return !ends_basic_block(opcode);
+    }
+}
+
+// Adjacent instructions the block cache runs as one superinstruction (see Cpu::run_fused), the most frequent
+// sequences reported by OpcodeProfiler. Longer sequences come first so they win over their own prefixes
+struct FusedSequence
+{
+    uint8_t length;
+    uint8_t opcodes[3];
+};
+
+constexpr FusedSequence FUSED_SEQUENCES[] = {
+    {3, {0x0B, 0x78, 0xB1}}, // DEC BC / LD A, B / OR C
+    {3, {0x1B, 0x7A, 0xB3}}, // DEC DE / LD A, D / OR E
+    {3, {0x78, 0xB1, 0x20}}, // LD A, B / OR C / JR NZ
+    {3, {0xF0, 0xFE, 0x20}}, // LDH A, (u8) / CP u8 / JR NZ
+    {3, {0xF0, 0xFE, 0x28}}, // LDH A, (u8) / CP u8 / JR Z
+    {3, {0xF0, 0xE6, 0x20}}, // LDH A, (u8) / AND u8 / JR NZ
+    {3, {0xF0, 0xE6, 0x28}}, // LDH A, (u8) / AND u8 / JR Z
+    {3, {0xFA, 0x3C, 0xEA}}, // LD A, (u16) / INC A / LD (u16), A
+    {3, {0xFA, 0x3D, 0xEA}}, // LD A, (u16) / DEC A / LD (u16), A
+    {2, {0x05, 0x20}}, {2, {0x0D, 0x20}}, {2, {0x15, 0x20}}, {2, {0x1D, 0x20}}, // DEC r / JR NZ
+    {2, {0x25, 0x20}}, {2, {0x2D, 0x20}}, {2, {0x3D, 0x20}},
+    {2, {0xFE, 0x20}}, {2, {0xFE, 0x28}}, {2, {0xFE, 0x30}}, {2, {0xFE, 0x38}}, // CP u8 / JR cc
+    {2, {0xA7, 0x20}}, {2, {0xA7, 0x28}}, {2, {0xB7, 0x20}}, {2, {0xB7, 0x28}}, // AND A, OR A / JR NZ, JR Z
+    {2, {0xE6, 0x20}}, {2, {0xE6, 0x28}}, // AND u8 / JR NZ, JR Z
+    {2, {0x2A, 0x12}}, // LD A, (HL+) / LD (DE), A
+    {2, {0x1A, 0x22}}, // LD A, (DE) / LD (HL+), A
+    {2, {0x2A, 0x22}}, // LD A, (HL+) / LD (HL+), A
+    {2, {0x7E, 0x23}}, // LD A, (HL) / INC HL
+    {2, {0xF0, 0xFE}}, // LDH A, (u8) / CP u8
+    {2, {0xFA, 0xA7}}, // LD A, (u16) / AND A
+};
+
+constexpr bool fused_sequences_valid()
+{
+    for (const FusedSequence& sequence : FUSED_SEQUENCES)
+    {
+        if (sequence.length < 2 || sequence.length > 3)
+            return false;
+        for (int i = 0; i < sequence.length - 1; i++)
+            if (!fusable_lead(sequence.opcodes[i]))
+                return false;
+    }
+    return true;
+}
+static_assert(fused_sequences_valid(), "Only the last instruction of a fused sequence may store, branch or touch IME");
+
+// Index in FUSED_SEQUENCES of the sequence starting at opcodes[0], -1 if none matches in the available opcodes
+constexpr int fused_sequence(const uint8_t* opcodes, int available)
+{
+    for (int index = 0; index < static_cast<int>(std::size(FUSED_SEQUENCES)); index++)
+    {
+        const FusedSequence& sequence = FUSED_SEQUENCES[index];
+        if (sequence.length > available)
+            continue;
+        bool match = true;
+        for (int i = 0; i < sequence.length; i++)
+            match = match && opcodes[i] == sequence.opcodes[i];
+        if (match)
+            return index;
+    }
+    return -1;
+}
+
+// Length of the fused sequence starting at opcodes[0], 0 if none matches in the available opcodes
+constexpr int fused_length(const uint8_t* opcodes, int available)
+{
+    int index = fused_sequence(opcodes, available);
+    return index < 0 ? 0 : FUSED_SEQUENCES[index].length;
+}
@@ -38,6 +38,15 @@ enum class ShiftRotateOp : uint8_t {
     SLA = 4, SRA = 5, SWAP = 6, SRL = 7
 };
 
+// Kind of the last flag-setting operation, F is computed from it only when read (see Cpu::read_f)
+enum class FlagOp : uint8_t {
+    NONE = 0, // regs.f is current
+    ADD, ADC, SUB, SBC, // SUB also covers CP
+    AND, LOGIC, // LOGIC is XOR/OR, only Z can be set
+    INC, DEC, // 8-bit INC/DEC, C is carried over from before
+    SHIFT // CB shifts/rotates and SWAP, C is the bit shifted out
+};
+
 enum class alu_flags : uint8_t {
     NONE = 0,
     Z = 1 << 7, // Zero flag
@@ -1,6 +1,9 @@
+#pragma once
 #include <cstdint>
 #include <bus.h>
 
+class Scheduler; // Forward declaration
+
 struct dma_ctx
 {
     bool active;
@@ -12,16 +15,25 @@ struct dma_ctx
 class DMA
 {
     public:
-        void set_cmp(Bus* bus_ptr)
+        void set_cmp(Bus* bus_ptr, Scheduler* scheduler_ptr)
         {
             this->bus = bus_ptr;
+            this->scheduler = scheduler_ptr;
+            bus->map_io<&DMA::read, &DMA::write>(0xFF46, 0xFF46, this);
         }
+        // MMIO accessors for 0xFF46, a write starts a transfer from value << 8
+        uint8_t read(uint16_t address);
+        void write(uint16_t address, uint8_t value);
         void start(uint8_t value);
         void tick();
+        // Catch up to the master clock one M-cycle (one byte) at a time
+        void sync();
         bool is_active() const;
     private:
         Bus* bus;
+        Scheduler* scheduler;
         dma_ctx ctx;
+        uint64_t last_sync; // Master clock value the transfer state corresponds to
 
 
-};
\ No newline at end of file
+};
@@ -8,9 +8,11 @@
 #include "ppu.h"
 #include "dma.h"
 #include "lcd.h"
+#include "scheduler.h"
+#include "serial.h"
+#include "frame_pacer.h"
 struct emu_context 
 {
-    std::atomic<bool> paused;
     std::atomic<bool> running;
     std::atomic<uint64_t> ticks;
 };
@@ -25,17 +27,24 @@ class Emu
         Ppu ppu;
         DMA dma;
         LCD lcd;
+        Serial serial;
+        Scheduler scheduler;
+        FramePacer pacer;
     public:
         emu_context ctx;
         
         Emu(const std::string &rom_filename, const std::string &bootrom_filename);
         Emu(bool test_mode_enable);
         ROM* create_cartridge(const std::string &filename, const std::string& bootrom_filename);
+        void skip_bootrom(); // Start directly at 0x0100 with the DMG post-bootrom register state
 
         // Accessors for components
         ROM& get_rom() { return *rom; }
         Bus& get_bus() { return bus; }
         Cpu& get_cpu() { return cpu; }
         Ppu& get_ppu() { return ppu; }
+        Scheduler& get_scheduler() { return scheduler; }
+        Serial& get_serial() { return serial; }
+        FramePacer& get_pacer() { return pacer; }
         void set_component_pointers();
 };
\ No newline at end of file
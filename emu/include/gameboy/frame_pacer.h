@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Holds the emulation thread to the DMG frame rate (or a multiple of it) and parks it while paused
+class FramePacer
+{
+    private:
+        using clock = std::chrono::steady_clock;
+        static constexpr clock::duration SPIN_MARGIN = std::chrono::microseconds(1500); // Sleep overshoot the spin tail absorbs
+        static constexpr int MAX_FRAMES_BEHIND = 4; // Further behind than this (host stall, debugger) restarts the schedule instead of rushing
+        std::atomic<double> speed{1.0};
+        clock::time_point deadline; // When the frame being emulated is due, only touched by the emulation thread
+        bool restart = true; // Next wait_frame starts a new schedule from the current time
+        std::mutex pause_mutex;
+        std::condition_variable pause_cv;
+        bool paused = false;
+        bool stopped = false;
+    public:
+        static constexpr double FRAME_RATE = 4194304.0 / 70224.0; // 59.7275 Hz: T-cycles per second over T-cycles per frame
+        static constexpr double UNLIMITED = 0.0;
+        static constexpr double MIN_SPEED = 0.25;
+        static constexpr double MAX_SPEED = 16.0;
+
+        // Multiplier of FRAME_RATE, clamped to MIN_SPEED..MAX_SPEED, or UNLIMITED to run as fast as the host can
+        void set_speed(double multiplier);
+        double get_speed() const { return speed.load(std::memory_order_relaxed); }
+
+        void set_paused(bool pause);
+        bool is_paused();
+        // Wake the emulation thread for good, every wait returns false from now on
+        void stop();
+
+        // Emulation thread, between frames: parks while paused, then sleeps until the next frame is due.
+        // Returns false once stopped
+        bool wait_frame();
+};
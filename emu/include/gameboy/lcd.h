@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include "ppu.h"
+#include "bus.h"
 #include <unordered_map>
 
 struct pallette_data 
@@ -98,7 +99,7 @@ struct lcd_registers
     uint8_t scroll_x;    //FF43
     uint8_t lcd_y;       //FF44
     uint8_t lcd_y_compare; //FF45
-    //FF46 is DMA transfer register, handled directly in bus
+    //FF46 is DMA transfer register, handled by the DMA component
     pallette_data bg_palette;  //FF47
     pallette_data obj_palette_0; //FF48
     pallette_data obj_palette_1; //FF49
@@ -144,9 +145,10 @@ class LCD
     public:
         LCD();
         lcd_registers regs;
+        Bus* bus;
         Ppu* ppu;
         Cpu* cpu;
-        void set_cmp(Ppu* ppu_ptr, Cpu* cpu_ptr);
+        void set_cmp(Bus* bus_ptr, Ppu* ppu_ptr, Cpu* cpu_ptr);
         void lcd_write(uint16_t addr, uint8_t value);
         uint8_t lcd_read(uint16_t addr) const;
         void bump_ly();
@@ -1,12 +1,13 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <mutex>
-#include <vector>
 #include "ppu_constants.h"
 
 class Bus;
 class Cpu;
 class LCD;
+class Scheduler;
 
 
 struct oam_entry
@@ -34,6 +35,25 @@ struct vram_layout
     uint8_t tile_map_2[0x0400];  // 0x9C00-0x9FFF (1KB) -  Tile Map 2
 };
 
+// One tile of 0x8000-0x97FF decoded to color IDs, one byte per pixel, row by row. Sprites flipped horizontally
+// read x_flipped, which has every row mirrored
+struct decoded_tile
+{
+    uint8_t ids[64];
+    uint8_t x_flipped[64];
+    uint32_t generation; // Tile generation the IDs were decoded from
+};
+
+// One tile map composed into a 256x256 color-ID bitmap, for one tile data addressing mode. Each 8x8 cell remembers
+// the tile and tile generation it was drawn from; a row of cells is only checked again once VRAM has been written
+struct bg_bitmap
+{
+    uint8_t pixels[256 * 256];
+    uint16_t cell_tile[PpuConstants::TILE_MAP_WIDTH * PpuConstants::TILE_MAP_HEIGHT];
+    uint32_t cell_generation[PpuConstants::TILE_MAP_WIDTH * PpuConstants::TILE_MAP_HEIGHT];
+    uint64_t row_generation[PpuConstants::TILE_MAP_HEIGHT]; // vram_generation each cell row was last checked at
+};
+
 struct scanline_state_t
 {
     uint8_t scx;
@@ -42,7 +62,8 @@ struct scanline_state_t
     uint8_t wx;
     uint8_t wy;
     uint8_t window_line_counter; //Counts which line of the window is being drawn
-    std::vector<int> overlap_sprite_indices; 
+    uint8_t line_sprites[10]; // OAM indices of the sprites on this line (at most 10), sorted by X then OAM index
+    uint8_t line_sprite_count;
     bool background_enabled; //Based on LCDC bit 0
     bool objs_enabled;       //Based on LCDC bit 1
     bool obj_size;          //Based on LCDC bit 2, false = 8x8, true = 8x16
@@ -51,8 +72,8 @@ struct scanline_state_t
 struct scanline_context
 {
     uint8_t* vram_base_ptr;
-    uint8_t* bg_map_base_ptr;
-    uint8_t* win_map_base_ptr;
+    uint8_t  bg_map;  // 0 for the 0x9800 map, 1 for 0x9C00
+    uint8_t  win_map;
     uint16_t tile_data_base_addr;
     bool     window_enabled;
     int      wx_start;
@@ -64,28 +85,37 @@ public:
     Bus* bus;
     LCD* lcd;
     Cpu* cpu;
+    Scheduler* scheduler;
     oam_entry oam[40] = {};
     Ppu();
     uint16_t dot = 0; //Dot is current cycle within a scanline (as referred to in the Pandocs)
-    void set_cmp(Bus* bus_ptr, LCD* lcd_ptr, Cpu* cpu_ptr);
-    void ppu_tick();
+    uint64_t frame_count = 0; //Number of frames completed (incremented on entering VBlank)
+    void set_cmp(Bus* bus_ptr, LCD* lcd_ptr, Cpu* cpu_ptr, Scheduler* scheduler_ptr);
+    // Run the PPU for a number of dots, doing the scanline work at each mode boundary crossed
+    void advance(uint64_t dots);
+    // Catch up to the master clock, called by the scheduler at the next mode boundary
+    void sync();
 
-    // Double-buffered access - rendering thread gets front buffer
+    // Rendering thread reads the front buffer, which only changes in swap_buffers
     const uint8_t* get_screen_buffer() const { return screen_front; }
     const uint8_t* get_vram_buffer() const { return reinterpret_cast<const uint8_t*>(vram_front); }
     const uint8_t* get_tilemap_buffer() const { return vram_front->tile_map_1; }
 
     
-    // Swap buffers - call this once per frame from emulation thread
+    // Pick up the newest frame published at VBlank, if there is one - call this from the rendering thread
     void swap_buffers();
     
     // Get mutex for locking during VRAM access from rendering thread
     std::mutex& get_vram_mutex() { return vram_mutex; }
-    std::mutex& get_screen_mutex() { return screen_mutex; }
 
     // VRAM accessors (no mutex needed - writing to back buffer)
     uint8_t vram_read(uint16_t address) const;
     void vram_write(uint16_t address, uint8_t value);
+    // address..address+count-1 was stored to through get_vram_pages, drop what the caches built from it
+    void invalidate_vram(uint16_t address, uint32_t count);
+
+    // Host pointer to VRAM for the bus page table, nullptr while VRAM is locked during pixel transfer
+    uint8_t* get_vram_pages();
 
     // OAM accessors
     uint8_t oam_read(uint16_t address) const;
@@ -97,23 +127,45 @@ private:
     vram_layout* vram_back = &vram_buffers[0];  // Emulation thread writes here
     vram_layout* vram_front = &vram_buffers[1]; // Rendering thread reads from here
     
-    // Double-buffered screen buffer - using memcpy
-    uint8_t screen_buffers[2][PpuConstants::SCREEN_BUFFER_SIZE] = {};
+    // Triple-buffered screen: the PPU hands a finished frame over by swapping its back index with the shared one,
+    // the renderer takes it by swapping its front index the same way, so neither side copies or waits
+    static constexpr uint8_t FRESH_FRAME = 0x80; // Set in screen_shared while it holds a frame the renderer hasn't taken
+    uint8_t screen_buffers[3][PpuConstants::SCREEN_BUFFER_SIZE] = {};
+    uint8_t screen_back_index = 0;
+    uint8_t screen_front_index = 1;
+    std::atomic<uint8_t> screen_shared{2};
     uint8_t* screen_back = screen_buffers[0];  // Emulation thread writes here
     uint8_t* screen_front = screen_buffers[1]; // Rendering thread reads from here
     
+    // Decoded tile cache, a tile is decoded again the first time it is drawn after a write to its 16 bytes
+    decoded_tile tile_cache[PpuConstants::TILE_COUNT] = {};
+    uint32_t tile_generation[PpuConstants::TILE_COUNT]; // Bumped by every write to the tile
+    uint64_t vram_generation = 1; // Bumped by every VRAM write
+    const decoded_tile& get_decoded_tile(int tile);
+
+    // Bit i of sprite_buckets[ly] is set when sprite i covers line ly at 8x16, kept up to date by oam_write.
+    // 8x8 sprites are the top half, so the bottom 8 lines are filtered out during the search
+    uint64_t sprite_buckets[PpuConstants::VISIBLE_SCANLINES] = {};
+    void move_sprite_bucket(int sprite, uint8_t old_y, uint8_t new_y);
+
+    // Both tile maps composed for both addressing modes, indexed by map * 2 + (1 for 0x8000 addressing)
+    bg_bitmap bg_bitmaps[4] = {};
+    const uint8_t* get_bg_bitmap_row(int map, bool unsigned_tiles, uint8_t y);
+
     uint8_t bgwin_color_ids[PpuConstants::SCREEN_BUFFER_SIZE] = {}; // Using this to track raw BG color IDs for sprite priority handling, 
 
     // Mutex for thread-safe VRAM access from rendering thread
     mutable std::mutex vram_mutex;
-    mutable std::mutex screen_mutex;
 
     scanline_context sctx = {}; // Used for per-scanline constants (pointers/ints/bools) that are helper values for pixel rendering (not internal GB state)
     scanline_state_t sst = {}; // Used for internal gameboy values (LY/SCX/SCY/WX/WY/etc)
+    uint64_t last_sync = 0; // Master clock value the PPU state corresponds to
+    uint16_t dots_to_next_boundary() const;
+    void publish_frame();
     void handle_oam_search();
     void handle_pixel_transfer();
     void handle_hblank();
     void handle_vblank();
-    void set_pixel(int x, int y, int offx, int offy, bool is_window, const scanline_context& ctx);
-    void oam_render_scanline(const scanline_context& ctx);
+    void render_tile_span(int x_begin, int x_end, uint8_t map_x, uint8_t map_y, int map, const scanline_context& ctx);
+    void oam_render_scanline();
 };
\ No newline at end of file
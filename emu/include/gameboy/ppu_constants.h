@@ -15,6 +15,8 @@ namespace PpuConstants {
     // Tile dimensions
     constexpr int TILE_MAP_WIDTH = 32;
     constexpr int TILE_MAP_HEIGHT = 32;
+    constexpr int TILE_COUNT = 384; // Tiles in 0x8000-0x97FF
+    constexpr int TILE_DATA_SIZE = TILE_COUNT * 16;
     
     // Memory sizes
     constexpr int VRAM_SIZE = 0x2000; // 8KB
@@ -30,5 +30,7 @@ class MBC1 : public ROM
         MBC1(RomData& romData);
         uint8_t cart_read(uint16_t addr) override;
         void cart_write(uint16_t addr, uint8_t value) override;
+        const uint8_t* cart_page(uint8_t page) override;
+        int rom_bank(uint16_t addr) override;
         
 };
\ No newline at end of file
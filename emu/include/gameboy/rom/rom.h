@@ -12,6 +12,8 @@ class ROM
         ROM(RomData& romData);
         virtual uint8_t cart_read(uint16_t addr); // Will be overridden by MBC classes if ROM is MBC
         virtual void cart_write(uint16_t addr, uint8_t value); // Will be overridden by MBC classes if ROM is MBC
+        virtual const uint8_t* cart_page(uint8_t page); // Host pointer to the 256 bytes currently mapped at page << 8, nullptr if not plain memory
+        virtual int rom_bank(uint16_t addr); // 16 KiB ROM bank mapped at addr (0x0000-0x7FFF), -1 while the bootrom overlays it
         cart_context ctx;
         void disable_bootrom();
     
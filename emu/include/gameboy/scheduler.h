@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <cstddef>
+
+class Timer; // Forward declaration
+class Ppu; // Forward declaration
+class DMA; // Forward declaration
+class Serial; // Forward declaration
+
+// One slot per event source, the slot index is also the dispatch order when several events are due at once
+enum class SchedulerEvent : uint8_t
+{
+    TIMER = 0,
+    PPU = 1,
+    DMA = 2,
+    SERIAL = 3,
+    COUNT = 4
+};
+
+class Scheduler
+{
+    private:
+        Timer* timer;
+        Ppu* ppu;
+        DMA* dma;
+        Serial* serial;
+        std::array<uint64_t, static_cast<std::size_t>(SchedulerEvent::COUNT)> deadlines;
+        uint64_t next_deadline; // Cached minimum of deadlines, checked on every advance
+        void recompute_next();
+        void dispatch();
+        void fire(SchedulerEvent event);
+    public:
+        static constexpr uint64_t NEVER = UINT64_MAX;
+        uint64_t now = 0; // Master clock in T-cycles since power on
+
+        Scheduler();
+        // Set component pointers
+        void set_cmp(Timer* timer_ptr, Ppu* ppu_ptr, DMA* dma_ptr, Serial* serial_ptr) { timer = timer_ptr; ppu = ppu_ptr; dma = dma_ptr; serial = serial_ptr; }
+        void schedule(SchedulerEvent event, uint64_t when);
+        void cancel(SchedulerEvent event);
+        uint64_t get_next_deadline() const { return next_deadline; }
+
+        // Advance the master clock, components only run when the nearest deadline has been reached
+        inline void advance(uint32_t t_cycles)
+        {
+            now += t_cycles;
+            if (now >= next_deadline)
+                dispatch();
+        }
+};
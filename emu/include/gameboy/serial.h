@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+class Bus; // Forward declaration
+class Scheduler; // Forward declaration
+class Serial; // Forward declaration
+
+// Other end of the link cable: takes each byte shifted out and returns the byte shifted in
+class SerialSink
+{
+    public:
+        virtual ~SerialSink() = default;
+        virtual uint8_t exchange(uint8_t out) = 0;
+};
+
+// Text written to stdout, flushed on newline or every 128 bytes (test ROMs print their results this way)
+class StdoutSerialSink : public SerialSink
+{
+    public:
+        ~StdoutSerialSink() override;
+        uint8_t exchange(uint8_t out) override;
+    private:
+        std::string line;
+};
+
+class FileSerialSink : public SerialSink
+{
+    public:
+        explicit FileSerialSink(const std::string& path) : file(path, std::ios::binary) {}
+        bool is_open() const { return file.is_open(); }
+        uint8_t exchange(uint8_t out) override;
+    private:
+        std::ofstream file;
+};
+
+// Keeps everything sent, for tests and tools that inspect the output
+class BufferSerialSink : public SerialSink
+{
+    public:
+        uint8_t exchange(uint8_t out) override { data += static_cast<char>(out); return 0xFF; }
+        std::string data;
+};
+
+// Link cable to the serial port of another instance driven by the same thread: the byte goes into the peer's SB
+// and the peer's SB comes back, the transfer the peer has armed on the external clock completes on its next event
+class PeerSerialSink : public SerialSink
+{
+    public:
+        explicit PeerSerialSink(Serial& peer_port) : peer(peer_port) {}
+        uint8_t exchange(uint8_t out) override;
+    private:
+        Serial& peer;
+};
+
+class Serial
+{
+    public:
+        // 8 bits at 8192 Hz on the internal clock
+        static constexpr uint64_t TRANSFER_CYCLES = 4096;
+
+        Serial();
+        // Set component pointers
+        void set_cmp(Bus* bus_ptr, Scheduler* scheduler_ptr);
+        // 0xFF01 SB, 0xFF02 SC: setting bit 7 with the internal clock (bit 0) starts a transfer
+        uint8_t read(uint16_t address);
+        void write(uint16_t address, uint8_t value);
+        // Transfer complete event
+        void sync();
+        // Byte clocked in by a peer on its internal clock, returns the byte shifted out and schedules the completion
+        uint8_t receive(uint8_t in);
+        // nullptr disconnects the cable, a transfer then shifts in 0xFF
+        void set_sink(std::unique_ptr<SerialSink> new_sink) { sink = std::move(new_sink); }
+        SerialSink* get_sink() { return sink.get(); }
+
+    private:
+        Bus* bus;
+        Scheduler* scheduler;
+        std::unique_ptr<SerialSink> sink;
+        uint8_t sb;
+        uint8_t sc;
+        uint8_t peer_in;   // Byte a peer clocked in, written to SB when the SERIAL event fires
+        bool peer_clocked; // The pending SERIAL event completes an external clock transfer
+        void complete(uint8_t in);
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+// 2bpp tile row decoding shared by the PPU and the debug viewers. A tile row is two bytes, low bitplane then high
+// bitplane, bit 7 being the leftmost pixel; rows are read back to back, 8 color IDs are written per row
+enum class TileDecodeKernel : uint8_t
+{
+    SCALAR = 0,
+    SSE2 = 1,
+    AVX2 = 2
+};
+
+// Decode rows tile rows from planes into ids, and when shades is not null also map each ID through a DMG palette byte
+// (BGP/OBP layout, two bits per color ID). Uses the fastest kernel the host supports unless one was forced
+void decode_tile_rows(const uint8_t* planes, int rows, uint8_t* ids, uint8_t* shades = nullptr, uint8_t palette = 0xE4);
+
+TileDecodeKernel get_tile_decode_kernel();
+// Force a kernel (benchmarks, cross-checking), returns false and keeps the current one if the host can't run it
+bool set_tile_decode_kernel(TileDecodeKernel kernel);
+bool tile_decode_kernel_supported(TileDecodeKernel kernel);
+const char* tile_decode_kernel_name(TileDecodeKernel kernel);
@@ -3,23 +3,36 @@
 #include "bus.h"
 #pragma once
 
+class Scheduler; // Forward declaration
+
 class Timer
 {
     private:
-        uint16_t div, old_div;
+        // DIV is not stored, it is the low 16 bits of the T-cycles elapsed since div_epoch
+        uint64_t div_epoch; // Master clock value at which the internal 16-bit divider was last zero
         uint8_t tima, tma, tac;
         Bus* bus;
-        void falling_edge_check();
+        Scheduler* scheduler;
+        uint64_t last_sync; // Master clock value tima corresponds to
+        uint8_t edge_shift() const; // log2 of the T-cycles between falling edges of the DIV bit selected by TAC
+        void increment_tima(uint64_t edges);
+        void schedule_overflow();
     public:
         Timer();
         // Set component pointers
-        void set_cmp(Bus* bus_ptr) { bus = bus_ptr; }
-        void tick();
+        void set_cmp(Bus* bus_ptr, Scheduler* scheduler_ptr)
+        {
+            bus = bus_ptr;
+            scheduler = scheduler_ptr;
+            bus->map_io<&Timer::read, &Timer::write>(0xFF04, 0xFF07, this);
+        }
+        // Catch up to the master clock, called on register access and when the overflow event fires
+        void sync();
         // MMIO accessors for timer registers
         // 0xFF04 DIV (read upper 8 bits), write resets
         // 0xFF05 TIMA
         // 0xFF06 TMA
         // 0xFF07 TAC
-        uint8_t read(uint16_t address) const;
+        uint8_t read(uint16_t address);
         void write(uint16_t address, uint8_t value);
-};
\ No newline at end of file
+};
@@ -54,6 +54,8 @@ public:
 
 public slots:
     void handleRecentFileAction(QAction* action);
+    void handleSpeedAction(QAction* action);
+    void setPaused(bool paused);
 
 #ifdef ENABLE_DEBUG_VIEWERS
     void openTileViewer();
@@ -63,6 +65,9 @@ public slots:
 private:
     Ui::MainWindow *ui;
     std::thread emuThread;
+    QAction* actionPause = nullptr;
+    double emuSpeed = 1.0; // Kept across ROM loads, FramePacer::UNLIMITED for no pacing
+    void createEmulationMenu();
     void startEmulator(const std::string& romPath, const std::string& bootromPath = "roms/dmg_boot.gb");
 };
 #endif // MAINWINDOW_H
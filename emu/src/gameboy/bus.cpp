@@ -3,7 +3,9 @@
 #include "timer.h"
 #include "ppu.h"
 #include "dma.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <cstdio>
 #include <iostream>
 #include "lcd.h"
@@ -11,6 +13,7 @@
 Bus::Bus() : rom(nullptr), timer(nullptr), ppu(nullptr), ie_register(0), if_register(0), test_mode(false)
 {
     init_memory_table();
+    init_io_table();
 }
 
 Bus::Bus(bool test_mode_enable) : rom(nullptr), timer(nullptr), ppu(nullptr), ie_register(0), if_register(0), test_mode(test_mode_enable)
@@ -27,19 +30,144 @@ void Bus::init_memory_table()
         {MemoryMap::WRAM_START, MemoryMap::WRAM_END, &Bus::wram_read, &Bus::wram_write},
         {MemoryMap::ECHO_START, MemoryMap::ECHO_END, &Bus::echoram_read, &Bus::echoram_write},
         {MemoryMap::OAM_START, MemoryMap::OAM_END, &Bus::oam_read, &Bus::oam_write},
-        {MemoryMap::LCD_START, MemoryMap::LCD_END, &Bus::lcd_read, &Bus::lcd_write},
         {MemoryMap::IO_START, MemoryMap::IO_END, &Bus::io_read, &Bus::io_write},
         {MemoryMap::HRAM_START, MemoryMap::IE_REGISTER, &Bus::hram_read, &Bus::hram_write}
     }};
 }
 
+void Bus::init_io_table()
+{
+    // Registers owned by the bus itself, other components register theirs in set_cmp
+    map_io<&Bus::if_read, &Bus::if_write>(MemoryMap::IF_REGISTER, MemoryMap::IF_REGISTER, this);
+    map_io<nullptr, &Bus::bootrom_disable_write>(0xFF50, 0xFF50, this);
+    map_io<&Bus::audio_read, &Bus::audio_write>(MemoryMap::AUDIO_START, MemoryMap::AUDIO_END, this);
+    map_io<&Bus::audio_read, &Bus::audio_write>(MemoryMap::WAVE_RAM_START, MemoryMap::WAVE_RAM_END, this);
+}
+
+
+void Bus::init_page_table()
+{
+    read_pages.fill(nullptr);
+    write_pages.fill(nullptr);
+    for (size_t page = 0; page < (MemoryMap::ERAM_SIZE >> 8); page++) {
+        read_pages[(MemoryMap::ERAM_START >> 8) + page] = eram + (page << 8);
+        write_pages[(MemoryMap::ERAM_START >> 8) + page] = eram + (page << 8);
+    }
+    for (size_t page = 0; page < (MemoryMap::WRAM_SIZE >> 8); page++) {
+        read_pages[(MemoryMap::WRAM_START >> 8) + page] = wram + (page << 8);
+        write_pages[(MemoryMap::WRAM_START >> 8) + page] = wram + (page << 8);
+    }
+    // Echo RAM mirrors WRAM up to 0xFDFF, page 0xFE holds OAM and stays on the handler path
+    for (size_t page = (MemoryMap::ECHO_START >> 8); page <= (MemoryMap::ECHO_END >> 8); page++) {
+        read_pages[page] = wram + ((page << 8) - MemoryMap::ECHO_START);
+        write_pages[page] = wram + ((page << 8) - MemoryMap::ECHO_START);
+    }
+    map_rom_pages();
+    map_vram_pages();
+}
 
-uint8_t Bus::bus_read(uint16_t address)
+void Bus::map_rom_pages()
 {
-    #ifdef OPCODE_TEST
-        return opcode_test_mem[address];
-    #endif
+    // ROM is never written directly (writes go to the MBC registers), so only the read side is mapped
+    bool changed = false;
+    for (size_t page = 0; page <= (MemoryMap::ROM_BANK_NN_END >> 8); page++) {
+        const uint8_t* mapped = rom ? rom->cart_page(static_cast<uint8_t>(page)) : nullptr;
+        changed |= mapped != read_pages[page];
+        read_pages[page] = mapped;
+    }
+    if (changed)
+        rom_map_generation++; // RAM enable and rewrites of the current bank leave running code alone
+}
+
+int Bus::rom_bank(uint16_t address)
+{
+    return rom ? rom->rom_bank(address) : -1;
+}
+
+void Bus::map_vram_pages()
+{
+    // nullptr while the PPU has VRAM locked, so accesses reach Ppu::vram_read/vram_write and get blocked there.
+    // VRAM is never written directly: Ppu::vram_write keeps the decoded tile and background caches in step
+    vram_pages = ppu ? ppu->get_vram_pages() : nullptr;
+    for (size_t page = 0; page < (MemoryMap::VRAM_SIZE >> 8); page++) {
+        read_pages[(MemoryMap::VRAM_START >> 8) + page] = vram_pages ? vram_pages + (page << 8) : nullptr;
+        write_pages[(MemoryMap::VRAM_START >> 8) + page] = nullptr;
+    }
+}
+
+// True if every page count bytes from address touch (wrapping at 0xFFFF) has a host pointer
+template <typename PageLookup>
+static bool pages_mapped(PageLookup page_at, uint16_t address, uint32_t count)
+{
+    uint32_t page_count = ((address & 0xFF) + count + 0xFF) >> 8;
+    for (uint32_t page = 0; page < page_count; page++) {
+        if (!page_at(static_cast<uint8_t>((address >> 8) + page)))
+            return false;
+    }
+    return true;
+}
+
+// Plain pages, plus VRAM while it is unlocked: the caller reports those stores to the PPU
+uint8_t* Bus::bulk_write_page(uint8_t page) const
+{
+    if (write_pages[page])
+        return write_pages[page];
+    uint32_t offset = static_cast<uint32_t>(page << 8) - MemoryMap::VRAM_START;
+    if (vram_pages && offset < MemoryMap::VRAM_SIZE)
+        return vram_pages + offset;
+    return nullptr;
+}
+
+static bool is_vram(uint16_t address)
+{
+    return static_cast<uint16_t>(address - MemoryMap::VRAM_START) < MemoryMap::VRAM_SIZE;
+}
+
+bool Bus::bulk_copy(uint16_t dst, uint16_t src, uint32_t count)
+{
+    if (!pages_mapped([this](uint8_t page) { return read_pages[page]; }, src, count) ||
+        !pages_mapped([this](uint8_t page) { return bulk_write_page(page); }, dst, count))
+        return false;
+    while (count) {
+        uint32_t chunk = std::min({count, 0x100u - (src & 0xFF), 0x100u - (dst & 0xFF)});
+        const uint8_t* from = read_pages[src >> 8] + (src & 0xFF);
+        uint8_t* to = bulk_write_page(dst >> 8) + (dst & 0xFF);
+        if (to + chunk <= from || from + chunk <= to) {
+            std::memcpy(to, from, chunk);
+        } else {
+            for (uint32_t i = 0; i < chunk; i++) // Overlapping (echo RAM or a short stride), later reads see earlier stores
+                to[i] = from[i];
+        }
+        if (is_vram(dst))
+            ppu->invalidate_vram(dst, chunk);
+        src += chunk;
+        dst += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+bool Bus::bulk_fill(uint16_t dst, uint8_t value, uint32_t count)
+{
+    if (!pages_mapped([this](uint8_t page) { return bulk_write_page(page); }, dst, count))
+        return false;
+    while (count) {
+        uint32_t chunk = std::min(count, 0x100u - (dst & 0xFF));
+        std::memset(bulk_write_page(dst >> 8) + (dst & 0xFF), value, chunk);
+        if (is_vram(dst))
+            ppu->invalidate_vram(dst, chunk);
+        dst += chunk;
+        count -= chunk;
+    }
+    return true;
+}
 
+uint8_t Bus::bus_read_slow(uint16_t address)
+{
+    if (address >= MemoryMap::IO_START && address <= MemoryMap::IO_END)
+        return io_read(address); // Skip the region walk for register polling
+    if (address >= MemoryMap::HRAM_START && address <= MemoryMap::HRAM_END)
+        return high_ram[address - MemoryMap::HRAM_START]; // Page 0xFF is shared with I/O, so HRAM can't be a page entry
     for (const auto& region : memory_regions) {
         if (address >= region.start && address <= region.end) {
             return (this->*region.read_fn)(address);
@@ -48,13 +176,16 @@ uint8_t Bus::bus_read(uint16_t address)
     return 0xFF; // Default for unmapped areas
 }
 
-void Bus::bus_write(uint16_t address, uint8_t data)
+void Bus::bus_write_slow(uint16_t address, uint8_t data)
 {
-    #ifdef OPCODE_TEST
-        opcode_test_mem[address] = data;
+    if (address >= MemoryMap::IO_START && address <= MemoryMap::IO_END) {
+        io_write(address, data);
         return;
-    #endif
-    
+    }
+    if (address >= MemoryMap::HRAM_START && address <= MemoryMap::HRAM_END) {
+        high_ram[address - MemoryMap::HRAM_START] = data;
+        return;
+    }
     for (const auto& region : memory_regions) {
         if (address >= region.start && address <= region.end) {
             (this->*region.write_fn)(address, data);
@@ -73,39 +204,33 @@ void Bus::vram_write(uint16_t address, uint8_t value)
 
 void Bus::io_write(uint16_t address, uint8_t value)
 {
-    // Bootrom disable register (0xFF50) - write to ROM component
-    if (address == 0xFF50 && rom) {
-        std::cout << "Bus::io_write: write to 0xFF50, value=" << std::hex << (int)value << std::dec << std::endl;
-        rom->disable_bootrom();
-        // Don't store in io array, this is write-only
-        return;
-    }
-    
-    // Route timer register writes to Timer component when attached
-    if (timer && (address >= 0xFF04 && address <= 0xFF07)) {
-        timer->write(address, value);
-        return;
-    }
-    // Interrupt Flag (IF) register at 0xFF0F is special: store in if_register
-    if (address == MemoryMap::IF_REGISTER) {
-        if_register = value;
+    const IoHandler& handler = io_handlers[address - MemoryMap::IO_START];
+    if (handler.write_fn) {
+        handler.write_fn(handler.owner, address, value);
         return;
     }
+    io[address - MemoryMap::IO_START] = value;
+}
 
-    if (address == 0xFF46 && dma) {
-        // Start DMA transfer
-        dma->start(value);
-        return;
-    }
-    
-    // Route audio register writes
-    if ((address >= MemoryMap::AUDIO_START && address <= MemoryMap::AUDIO_END) ||
-        (address >= MemoryMap::WAVE_RAM_START && address <= MemoryMap::WAVE_RAM_END)) {
-        audio_write(address, value);
+void Bus::bootrom_disable_write(uint16_t /*address*/, uint8_t value)
+{
+    // Bootrom disable register (0xFF50) - write to ROM component
+    if (!rom)
         return;
-    }
-    
-    io[address - MemoryMap::IO_START] = value;
+    std::cout << "Bus::io_write: write to 0xFF50, value=" << std::hex << (int)value << std::dec << std::endl;
+    rom->disable_bootrom();
+    map_rom_pages(); // Page 0 goes back to the cartridge
+    // Don't store in io array, this is write-only
+}
+
+uint8_t Bus::if_read(uint16_t /*address*/)
+{
+    return if_register;
+}
+
+void Bus::if_write(uint16_t /*address*/, uint8_t value)
+{
+    if_register = value;
 }
 
 void Bus::oam_write(uint16_t address, uint8_t value)
@@ -127,19 +252,9 @@ uint8_t Bus::vram_read(uint16_t address)
 
 uint8_t Bus::io_read(uint16_t address)
 {
-    if (timer && address >= 0xFF04 && address <= 0xFF07) 
-        return timer->read(address);
-    // Interrupt Flag (IF) register at 0xFF0F: read from if_register
-    if (address == MemoryMap::IF_REGISTER) {
-        return if_register;
-    }
-    
-    // Route audio register reads
-    if ((address >= MemoryMap::AUDIO_START && address <= MemoryMap::AUDIO_END) ||
-        (address >= MemoryMap::WAVE_RAM_START && address <= MemoryMap::WAVE_RAM_END)) {
-        return audio_read(address);
-    }
-    
+    const IoHandler& handler = io_handlers[address - MemoryMap::IO_START];
+    if (handler.read_fn)
+        return handler.read_fn(handler.owner, address);
     return io[address - MemoryMap::IO_START];
 }
 
@@ -192,6 +307,7 @@ uint8_t Bus::rom_read(uint16_t address)
 void Bus::rom_write(uint16_t address, uint8_t value)
 {
     rom->cart_write(address, value);
+    map_rom_pages(); // The write may have switched banks
 }
 
 uint8_t Bus::hram_read(uint16_t address)
@@ -211,16 +327,6 @@ void Bus::hram_write(uint16_t address, uint8_t value)
     }
 }
 
-uint8_t Bus::lcd_read(uint16_t address)
-{
-    return lcd->lcd_read(address);
-}
-
-void Bus::lcd_write(uint16_t address, uint8_t value)
-{
-    lcd->lcd_write(address, value);
-}
-
 uint8_t Bus::audio_read(uint16_t address)
 {
     // Wave Pattern RAM (0xFF30-0xFF3F)
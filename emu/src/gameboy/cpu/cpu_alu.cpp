@@ -2,89 +2,62 @@
 #include "bus.h"
 
 // ===== ALU Operation Helper =====
-void Cpu::execute_alu_op(AluOp op, uint8_t operand) {
-    uint16_t result; //Using uint_16 here makes it much easier to detect a carry and half carry, ALU only deals with 8 bit registers so this works here
-    uint8_t carry_in; //For carry, check if result is > 0xFF (More than 8 bytes) for overflow
-    // For half carry. check for overflow from 4 bytes
-    switch (op) {
+// Flags are deferred: only the operands are recorded here and compute_f() derives Z/N/H/C when something reads F
+template <AluOp OP>
+void Cpu::execute_alu_op(uint8_t operand) {
+    uint8_t a = regs.a;
+    uint8_t carry_in;
+    switch (OP) {
         case AluOp::ADD:
-            result = regs.a + operand;
-            set_flag_z((result & 0xFF) == 0);
-            set_flag_n(false);
-            set_flag_h(((regs.a & 0x0F) + (operand & 0x0F)) > 0x0F);
-            set_flag_c(result > 0xFF);
-            regs.a = result & 0xFF;
+            regs.a = a + operand;
+            defer_flags(FlagOp::ADD, a, operand, 0, regs.a);
             break;
             
         case AluOp::ADC:
             carry_in = (get_flag_c() & 1);
-            result = regs.a + operand + carry_in;
-            set_flag_z((result & 0xFF) == 0);
-            set_flag_n(false);
-            set_flag_h(((regs.a & 0x0F) + (operand & 0x0F) + carry_in) > 0x0F);
-            set_flag_c(result > 0xFF);
-            regs.a = result & 0xFF;
+            regs.a = a + operand + carry_in;
+            defer_flags(FlagOp::ADC, a, operand, carry_in, regs.a);
             break;
             
         case AluOp::SUB:
-            result = regs.a - operand;
-            set_flag_z((result & 0xFF) == 0);
-            set_flag_n(true);
-            set_flag_h((regs.a & 0x0F) < (operand & 0x0F));
-            set_flag_c(regs.a < operand);
-            regs.a = result & 0xFF;
+            regs.a = a - operand;
+            defer_flags(FlagOp::SUB, a, operand, 0, regs.a);
             break;
             
         case AluOp::SBC:
             carry_in = (get_flag_c() & 1);
-            result = regs.a - operand - carry_in;
-            set_flag_z((result & 0xFF) == 0);
-            set_flag_n(true);
-            set_flag_h((int)(regs.a & 0x0F) - (int)(operand & 0x0F) - carry_in < 0);
-            set_flag_c((int)regs.a - (int)operand - carry_in < 0);
-            regs.a = result & 0xFF;
+            regs.a = a - operand - carry_in;
+            defer_flags(FlagOp::SBC, a, operand, carry_in, regs.a);
             break;
             
         case AluOp::AND:
-            regs.a &= operand;
-            set_flag_z(regs.a == 0);
-            set_flag_n(false);
-            set_flag_h(true);
-            set_flag_c(false);
+            regs.a = a & operand;
+            defer_flags(FlagOp::AND, a, operand, 0, regs.a);
             break;
             
         case AluOp::XOR:
-            regs.a ^= operand;
-            set_flag_z(regs.a == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(false);
+            regs.a = a ^ operand;
+            defer_flags(FlagOp::LOGIC, a, operand, 0, regs.a);
             break;
             
         case AluOp::OR:
-            regs.a |= operand;
-            set_flag_z(regs.a == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(false);
+            regs.a = a | operand;
+            defer_flags(FlagOp::LOGIC, a, operand, 0, regs.a);
             break;
             
         case AluOp::CP:
-            result = regs.a - operand;
-            set_flag_z((result & 0xFF) == 0);
-            set_flag_n(true);
-            set_flag_h((regs.a & 0x0F) < (operand & 0x0F));
-            set_flag_c(regs.a < operand);
+            defer_flags(FlagOp::SUB, a, operand, 0, static_cast<uint8_t>(a - operand));
             // Note: A is not modified
             break;
     }
 }
 
 // ===== Accumulator/Flag Operation Helper =====
-void Cpu::execute_acc_flag_op(AccFlagOp op) {
+template <AccFlagOp OP>
+void Cpu::execute_acc_flag_op() {
     uint8_t carry;
     
-    switch (op) {
+    switch (OP) {
         case AccFlagOp::RLCA: // Rotate left
             carry = (regs.a & 0x80) >> 7;
             regs.a = (regs.a << 1) | carry;
@@ -164,82 +137,79 @@ void Cpu::execute_acc_flag_op(AccFlagOp op) {
 }
 
 // ===== Shift/Rotate Operation Helper (CB prefix) =====
-void Cpu::execute_shift_rotate_op(ShiftRotateOp op, R8 reg) {
-    uint8_t value = read_r8(reg);
+template <ShiftRotateOp OP>
+uint8_t Cpu::execute_shift_rotate_op(uint8_t value) {
     uint8_t carry;
     
-    switch (op) {
+    switch (OP) {
         case ShiftRotateOp::RLC: // Rotate left
             carry = (value & 0x80) >> 7;
             value = (value << 1) | carry;
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
             
         case ShiftRotateOp::RRC: // Rotate right
             carry = value & 0x01;
             value = (value >> 1) | (carry << 7);
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
             
         case ShiftRotateOp::RL: // Rotate left through carry
             carry = (value & 0x80) >> 7;
             value = (value << 1) | (get_flag_c() & 1);
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
             
         case ShiftRotateOp::RR: // Rotate right through carry
             carry = value & 0x01;
             value = (value >> 1) | ((get_flag_c() & 1) << 7);
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
             
         case ShiftRotateOp::SLA: // Shift left arithmetic
             carry = (value & 0x80) >> 7;
             value <<= 1;
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
             
         case ShiftRotateOp::SRA: // Shift right arithmetic (preserve sign)
             carry = value & 0x01;
             value = (value >> 1) | (value & 0x80);
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
             
         case ShiftRotateOp::SWAP: // Swap nibbles
             value = ((value & 0x0F) << 4) | ((value & 0xF0) >> 4);
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(false);
+            carry = 0;
             break;
             
         case ShiftRotateOp::SRL: // Shift right logical
             carry = value & 0x01;
             value >>= 1;
-            set_flag_z(value == 0);
-            set_flag_n(false);
-            set_flag_h(false);
-            set_flag_c(carry != 0);
             break;
     }
-    
-    write_r8(reg, value);
+    defer_flags(FlagOp::SHIFT, 0, 0, carry, value); // Z from the result, N and H cleared, C is the bit shifted out
+    return value;
 }
+
+// Every op is instantiated here, the opcode handlers pick theirs at compile time
+template void Cpu::execute_alu_op<AluOp::ADD>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::ADC>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::SUB>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::SBC>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::AND>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::XOR>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::OR>(uint8_t);
+template void Cpu::execute_alu_op<AluOp::CP>(uint8_t);
+
+template void Cpu::execute_acc_flag_op<AccFlagOp::RLCA>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::RRCA>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::RLA>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::RRA>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::DAA>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::CPL>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::SCF>();
+template void Cpu::execute_acc_flag_op<AccFlagOp::CCF>();
+
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::RLC>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::RRC>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::RL>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::RR>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::SLA>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::SRA>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::SWAP>(uint8_t);
+template uint8_t Cpu::execute_shift_rotate_op<ShiftRotateOp::SRL>(uint8_t);
@@ -0,0 +1,22 @@
+#include "cpu_block_cache.h"
+
+DecodedBlock* BlockCache::find(uint16_t bank, uint16_t pc)
+{
+    if (bank >= banks.size() || !banks[bank])
+        return nullptr;
+    int32_t index = (*banks[bank])[pc & (BANK_SIZE - 1)];
+    return index < 0 ? nullptr : &blocks[index];
+}
+
+DecodedBlock& BlockCache::insert(uint16_t bank, uint16_t pc)
+{
+    if (bank >= banks.size())
+        banks.resize(bank + 1);
+    if (!banks[bank])
+    {
+        banks[bank] = std::make_unique<BankIndex>();
+        banks[bank]->fill(-1);
+    }
+    (*banks[bank])[pc & (BANK_SIZE - 1)] = static_cast<int32_t>(blocks.size());
+    return blocks.emplace_back();
+}
@@ -0,0 +1,181 @@
+#include "cpu.h"
+#include "bus.h"
+#include "scheduler.h"
+#include <algorithm>
+
+// Registers picked at run time from a recognized loop
+static uint16_t& pair_ref(cpu_registers& regs, R16_Group1 reg)
+{
+    switch (reg)
+    {
+        case R16_Group1::BC: return regs.bc;
+        case R16_Group1::DE: return regs.de;
+        case R16_Group1::HL: return regs.hl;
+        default: return regs.sp;
+    }
+}
+
+static uint8_t& r8_ref(cpu_registers& regs, R8 reg)
+{
+    switch (reg)
+    {
+        case R8::B: return regs.b;
+        case R8::C: return regs.c;
+        case R8::D: return regs.d;
+        case R8::E: return regs.e;
+        case R8::H: return regs.h;
+        case R8::L: return regs.l;
+        default: return regs.a;
+    }
+}
+
+static R16_Group1 pair_of(R8 reg)
+{
+    return static_cast<R16_Group1>(static_cast<uint8_t>(reg) >> 1);
+}
+
+bool Cpu::match_bulk_loop(const std::array<uint8_t, DecodedBlock::MAX_OPS>& opcodes, DecodedBlock& block)
+{
+    // Accepted shapes, the block already ends in a branch to its own start:
+    //   [LD A, (BC)/(DE)/(HL)/(HL+) | LD A, u8 | XOR A]  LD (BC)/(DE)/(HL)/(HL+), A  [INC BC/DE/HL]...
+    //   DEC r8 | DEC BC/DE, LD A, hi, OR lo  JR NZ / JP NZ
+    if (block.count > 8) // Longest shape: load, store, two increments, wide counter test, branch
+        return false;
+    BulkLoop loop;
+    int i = 0;
+    bool src_advanced = false;
+    bool dst_advanced = false;
+    switch (opcodes[i])
+    {
+        case 0x0A: loop.source = BulkSource::MEMORY; loop.src = R16_Group1::BC; i++; break;
+        case 0x1A: loop.source = BulkSource::MEMORY; loop.src = R16_Group1::DE; i++; break;
+        case 0x7E: loop.source = BulkSource::MEMORY; loop.src = R16_Group1::HL; i++; break;
+        case 0x2A: loop.source = BulkSource::MEMORY; loop.src = R16_Group1::HL; src_advanced = true; i++; break;
+        case 0x3E: loop.source = BulkSource::IMM8; loop.imm = static_cast<uint8_t>(block.ops[i].imm); i++; break;
+        case 0xAF: loop.source = BulkSource::ZERO; i++; break;
+        default: loop.source = BulkSource::A; break;
+    }
+
+    switch (opcodes[i++])
+    {
+        case 0x02: loop.dst = R16_Group1::BC; break;
+        case 0x12: loop.dst = R16_Group1::DE; break;
+        case 0x77: loop.dst = R16_Group1::HL; break;
+        case 0x22: loop.dst = R16_Group1::HL; dst_advanced = true; break;
+        default: return false;
+    }
+    if (loop.source == BulkSource::MEMORY && loop.src == loop.dst)
+        return false;
+
+    // Each pointer moves forward by one per iteration, after it has been used
+    for (; opcodes[i] == 0x03 || opcodes[i] == 0x13 || opcodes[i] == 0x23; i++)
+    {
+        R16_Group1 reg = static_cast<R16_Group1>(opcodes[i] >> 4);
+        if (loop.source == BulkSource::MEMORY && reg == loop.src && !src_advanced)
+            src_advanced = true;
+        else if (reg == loop.dst && !dst_advanced)
+            dst_advanced = true;
+        else
+            return false;
+    }
+    if (!dst_advanced || (loop.source == BulkSource::MEMORY && !src_advanced))
+        return false;
+
+    uint8_t counter_op = opcodes[i++];
+    if (counter_op == 0x05 || counter_op == 0x0D || counter_op == 0x15 || counter_op == 0x1D) // DEC B/C/D/E
+    {
+        loop.counter = static_cast<R8>(counter_op >> 3);
+        loop.counter_pair = pair_of(loop.counter);
+    }
+    else if (counter_op == 0x0B || counter_op == 0x1B) // DEC BC/DE, then LD A, hi / OR lo in either order
+    {
+        loop.wide_counter = true;
+        loop.counter_pair = static_cast<R16_Group1>(counter_op >> 4);
+        uint8_t high = static_cast<uint8_t>(loop.counter_pair) * 2;
+        uint8_t load = opcodes[i++];
+        uint8_t merge = opcodes[i++];
+        bool high_first = load == 0x78 + high && merge == 0xB0 + high + 1;
+        bool low_first = load == 0x78 + high + 1 && merge == 0xB0 + high;
+        if (!high_first && !low_first)
+            return false;
+        if (loop.source == BulkSource::A)
+            return false; // A is overwritten by the counter test, so it isn't a fill
+    }
+    else
+        return false;
+    if (loop.counter_pair == loop.dst || (loop.source == BulkSource::MEMORY && loop.counter_pair == loop.src))
+        return false;
+
+    if (i != block.count - 1 || (opcodes[i] != 0x20 && opcodes[i] != 0xC2)) // JR NZ / JP NZ
+        return false;
+
+    for (int op = 0; op < block.count; op++)
+    {
+        const InstructionInfo& info = INSTRUCTION_TABLE[opcodes[op]];
+        loop.iteration_cycles += 4 * (op == i ? info.cycles_branch : info.cycles);
+    }
+    block.bulk = loop;
+    return true;
+}
+
+uint64_t Cpu::run_bulk_loop(const DecodedBlock& block, uint64_t frame_target)
+{
+    const BulkLoop& loop = block.bulk;
+    uint16_t& counter_pair = pair_ref(regs, loop.counter_pair);
+    uint8_t& counter = r8_ref(regs, loop.counter);
+    uint32_t remaining = loop.wide_counter ? (counter_pair ? counter_pair : 0x10000) : (counter ? counter : 0x100);
+
+    // Whole iterations that end before the next event, minus the last one of the loop (its branch is not taken),
+    // which runs normally with whatever is left. Nothing the loop touches can change between events: VRAM locking
+    // and OAM DMA only move on PPU/DMA events, so the page table stays as it is for the whole window.
+    // An EI taking effect or an interrupt already waiting (EI; JP loop) is taken after the first instruction
+    uint64_t deadline = scheduler->get_next_deadline();
+    if (ime_delay || (ime && (bus->if_register & bus->ie_register & 0x1F)) || deadline <= scheduler->now || remaining < 2)
+        return run_block(block, frame_target);
+    uint64_t window = deadline == Scheduler::NEVER ? remaining : (deadline - 1 - scheduler->now) / loop.iteration_cycles;
+    uint32_t iterations = static_cast<uint32_t>(std::min<uint64_t>(remaining - 1, window));
+    if (iterations == 0)
+        return run_block(block, frame_target);
+
+    uint16_t& dst = pair_ref(regs, loop.dst);
+    bool copied = false;
+    switch (loop.source)
+    {
+        case BulkSource::MEMORY: copied = bus->bulk_copy(dst, pair_ref(regs, loop.src), iterations); break;
+        case BulkSource::IMM8: copied = bus->bulk_fill(dst, loop.imm, iterations); break;
+        case BulkSource::ZERO: copied = bus->bulk_fill(dst, 0, iterations); break;
+        default: copied = bus->bulk_fill(dst, regs.a, iterations); break;
+    }
+    if (!copied)
+        return run_block(block, frame_target); // MMIO, ROM or locked VRAM/OAM, one instruction at a time
+    bulk_stats.hits++;
+    bulk_stats.bytes += iterations;
+
+    // Leave the registers as the last skipped iteration did, back at the loop head
+    if (loop.source == BulkSource::MEMORY)
+        pair_ref(regs, loop.src) += iterations;
+    dst += iterations;
+    if (loop.wide_counter)
+    {
+        counter_pair -= iterations;
+        regs.a = static_cast<uint8_t>((counter_pair >> 8) | (counter_pair & 0xFF));
+        write_f(0x00); // OR with a non-zero result
+    }
+    else
+    {
+        uint8_t original = counter - static_cast<uint8_t>(iterations) + 1;
+        counter = original - 1;
+        if (loop.source == BulkSource::MEMORY)
+            regs.a = bus->bus_read(dst - 1); // Last byte copied
+        else if (loop.source == BulkSource::IMM8)
+            regs.a = loop.imm;
+        else if (loop.source == BulkSource::ZERO)
+        {
+            regs.a = 0;
+            write_f(0x80); // XOR A clears C before DEC carries it over
+        }
+        set_flags_dec(counter, original);
+    }
+    scheduler->now += static_cast<uint64_t>(iterations) * loop.iteration_cycles; // Stays below next_deadline
+    return static_cast<uint64_t>(iterations) * block.count;
+}
@@ -1,130 +1,13 @@
 #include "cpu.h"
 #include "bus.h"
 
-uint8_t* Cpu::get_r8_ptr(R8 reg) {
-    uint8_t* table[8] = {
-        &regs.b, &regs.c, &regs.d, &regs.e,
-        &regs.h, &regs.l, nullptr, &regs.a
-    };
-    return table[static_cast<uint8_t>(reg)];
+// (HL) operand of the r8 templates, out of line so cpu.h does not need the Bus definition
+uint8_t Cpu::read_hl_ind() {
+    return bus->bus_read(get_r16_group1<R16_Group1::HL>());
 }
 
-uint8_t Cpu::read_r8(R8 reg) {
-    if (reg == R8::HL_IND) {
-        uint16_t hl = (static_cast<uint16_t>(regs.h) << 8) | regs.l;
-        return bus->bus_read(hl);
-    }
-    return *get_r8_ptr(reg);
-}
-
-void Cpu::write_r8(R8 reg, uint8_t value) {
-    if (reg == R8::HL_IND) {
-        uint16_t hl = (static_cast<uint16_t>(regs.h) << 8) | regs.l;
-        bus->bus_write(hl, value);
-    } else {
-        *get_r8_ptr(reg) = value;
-    }
-}
-
-uint16_t Cpu::get_r16_group1(R16_Group1 reg) {
-    switch (reg) {
-        case R16_Group1::BC: return (static_cast<uint16_t>(regs.b) << 8) | regs.c;
-        case R16_Group1::DE: return (static_cast<uint16_t>(regs.d) << 8) | regs.e;
-        case R16_Group1::HL: return (static_cast<uint16_t>(regs.h) << 8) | regs.l;
-        case R16_Group1::SP: return regs.sp;
-    }
-    return 0;
-}
-
-void Cpu::set_r16_group1(R16_Group1 reg, uint16_t value) {
-    uint8_t low = static_cast<uint8_t>(value);
-    uint8_t high = static_cast<uint8_t>(value >> 8);
-    
-    switch (reg) {
-        case R16_Group1::BC: regs.c = low; regs.b = high; break;
-        case R16_Group1::DE: regs.e = low; regs.d = high; break;
-        case R16_Group1::HL: regs.l = low; regs.h = high; break;
-        case R16_Group1::SP: regs.sp = value; break;
-    }
-}
-
-// ===== R16 Group 2 Helper Methods (BC, DE, HL+, HL-) =====
-uint16_t Cpu::get_r16_group2(R16_Group2 reg) {
-    uint16_t hl = (static_cast<uint16_t>(regs.h) << 8) | regs.l;
-    
-    switch (reg) {
-        case R16_Group2::BC: return (static_cast<uint16_t>(regs.b) << 8) | regs.c;
-        case R16_Group2::DE: return (static_cast<uint16_t>(regs.d) << 8) | regs.e;
-        case R16_Group2::HL_INC: {
-            uint16_t result = hl;
-            hl++;
-            regs.h = hl >> 8;
-            regs.l = hl & 0xFF;
-            return result;
-        }
-        case R16_Group2::HL_DEC: {
-            uint16_t result = hl;
-            hl--;
-            regs.h = hl >> 8;
-            regs.l = hl & 0xFF;
-            return result;
-        }
-    }
-    return 0;
-}
-
-void Cpu::set_r16_group2(R16_Group2 reg, uint16_t value) {
-    // Similar to get but reversed for stores
-    uint16_t hl = (static_cast<uint16_t>(regs.h) << 8) | regs.l;
-    
-    switch (reg) {
-        case R16_Group2::BC: regs.c = value & 0xFF; regs.b = value >> 8; break;
-        case R16_Group2::DE: regs.e = value & 0xFF; regs.d = value >> 8; break;
-        case R16_Group2::HL_INC:
-            hl++;
-            regs.h = hl >> 8;
-            regs.l = hl & 0xFF;
-            break;
-        case R16_Group2::HL_DEC:
-            hl--;
-            regs.h = hl >> 8;
-            regs.l = hl & 0xFF;
-            break;
-    }
-}
-
-// ===== R16 Group 3 Helper Methods (BC, DE, HL, AF) =====
-uint16_t Cpu::get_r16_group3(R16_Group3 reg) {
-    switch (reg) {
-        case R16_Group3::BC: return (static_cast<uint16_t>(regs.b) << 8) | regs.c;
-        case R16_Group3::DE: return (static_cast<uint16_t>(regs.d) << 8) | regs.e;
-        case R16_Group3::HL: return (static_cast<uint16_t>(regs.h) << 8) | regs.l;
-        case R16_Group3::AF: return (static_cast<uint16_t>(regs.a) << 8) | regs.f;
-    }
-    return 0;
-}
-
-void Cpu::set_r16_group3(R16_Group3 reg, uint16_t value) {
-    uint8_t low = static_cast<uint8_t>(value);
-    uint8_t high = static_cast<uint8_t>(value >> 8);
-    
-    switch (reg) {
-        case R16_Group3::BC: regs.c = low; regs.b = high; break;
-        case R16_Group3::DE: regs.e = low; regs.d = high; break;
-        case R16_Group3::HL: regs.l = low; regs.h = high; break;
-        case R16_Group3::AF: regs.f = low & 0xF0; regs.a = high; break; // Mask lower 4 bits of F
-    }
-}
-
-// ===== Condition Code Helper =====
-bool Cpu::check_condition(ConditionCode cc) {
-    switch (cc) {
-        case ConditionCode::NZ: return !(regs.f & 0x80); // Zero flag not set
-        case ConditionCode::Z:  return (regs.f & 0x80);  // Zero flag set
-        case ConditionCode::NC: return !(regs.f & 0x10); // Carry flag not set
-        case ConditionCode::C:  return (regs.f & 0x10);  // Carry flag set
-    }
-    return false;
+void Cpu::write_hl_ind(uint8_t value) {
+    bus->bus_write(get_r16_group1<R16_Group1::HL>(), value);
 }
 
 // ===== Immediate Data Reading Helpers =====
@@ -143,48 +26,49 @@ int8_t Cpu::read_imm_signed8() {
 }
 
 // ===== Flag Manipulation Helpers =====
-void Cpu::set_flag_z(bool value) {
-    regs.f = (regs.f & ~static_cast<uint8_t>(alu_flags::Z)) | ((uint8_t)value << 7); // Unset the value then set it based on input,
-} 
-
-void Cpu::set_flag_n(bool value) {
-    regs.f = (regs.f & ~static_cast<uint8_t>(alu_flags::N)) | ((uint8_t)value << 6);
-}
-
-void Cpu::set_flag_h(bool value) {
-    regs.f = (regs.f & ~static_cast<uint8_t>(alu_flags::H)) | ((uint8_t)value << 5);
-}
-
-void Cpu::set_flag_c(bool value) {
-    regs.f = (regs.f & ~static_cast<uint8_t>(alu_flags::C)) | ((uint8_t)value << 4);
-}
-
-bool Cpu::get_flag_z() const {
-    return regs.f & 0x80; // Zero flag is bit 7
-}
-
-bool Cpu::get_flag_n() const {
-    return regs.f & 0x40; // Subtract flag is bit 6
-}
-
-bool Cpu::get_flag_h() const {
-    return regs.f & 0x20; // Half-carry flag is bit 5
-}
-
-bool Cpu::get_flag_c() const {
-    return regs.f & 0x10; // Carry flag is bit 4
-}
-
-void Cpu::set_flags_dec(uint8_t result, uint8_t original) {
-    set_flag_z(result == 0);
-    set_flag_n(true);
-    set_flag_h((result & 0x0F) == 0x0F); // Half-carry on borrow from bit 4, original - 1 cause lower nibble to be 0xF because of underflow
-    // Carry flag unchanged
-}
-
-void Cpu::set_flags_inc(uint8_t result, uint8_t original) {
-    set_flag_z(result == 0);
-    set_flag_n(false);
-    set_flag_h((original & 0x0F) == 0x0F); // Half-carry on carry from bit 3, original + 1 cause lower nibble to be 0 because of overflow
-    // Carry flag unchanged
+uint8_t Cpu::compute_f() const {
+    const lazy_flags& lf = pending_flags;
+    bool n = false;
+    bool h = false;
+    bool c = false;
+    switch (lf.op) {
+        case FlagOp::NONE:
+            return regs.f;
+        case FlagOp::ADD:
+            h = ((lf.lhs & 0x0F) + (lf.rhs & 0x0F)) > 0x0F;
+            c = (lf.lhs + lf.rhs) > 0xFF;
+            break;
+        case FlagOp::ADC:
+            h = ((lf.lhs & 0x0F) + (lf.rhs & 0x0F) + lf.carry) > 0x0F;
+            c = (lf.lhs + lf.rhs + lf.carry) > 0xFF;
+            break;
+        case FlagOp::SUB:
+            n = true;
+            h = (lf.lhs & 0x0F) < (lf.rhs & 0x0F);
+            c = lf.lhs < lf.rhs;
+            break;
+        case FlagOp::SBC:
+            n = true;
+            h = (int)(lf.lhs & 0x0F) - (int)(lf.rhs & 0x0F) - lf.carry < 0;
+            c = (int)lf.lhs - (int)lf.rhs - lf.carry < 0;
+            break;
+        case FlagOp::AND:
+            h = true;
+            break;
+        case FlagOp::LOGIC:
+            break;
+        case FlagOp::INC:
+            h = (lf.lhs & 0x0F) == 0x0F; // Half-carry on carry from bit 3, original + 1 cause lower nibble to be 0 because of overflow
+            c = lf.carry; // Carry flag unchanged
+            break;
+        case FlagOp::DEC:
+            n = true;
+            h = (lf.result & 0x0F) == 0x0F; // Half-carry on borrow from bit 4, original - 1 cause lower nibble to be 0xF because of underflow
+            c = lf.carry; // Carry flag unchanged
+            break;
+        case FlagOp::SHIFT:
+            c = lf.carry;
+            break;
+    }
+    return ((lf.result == 0) << 7) | (n << 6) | (h << 5) | (c << 4);
 }
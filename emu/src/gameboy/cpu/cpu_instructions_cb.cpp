@@ -1,47 +1,41 @@
 #include "cpu.h"
 #include "bus.h"
+#include <utility>
 
-//  Instruction Group Handler CB 
-void Cpu::execute_cb_instructions() {
-    uint8_t cb_opcode = static_cast<uint8_t>(fetched_data);
-    Opcode cb_op(cb_opcode);
-    R8 reg = static_cast<R8>(cb_op.z);
-    
-    switch (cb_op.x) {
-        case 0: // Shift/rotate operations
-            {
-                ShiftRotateOp op = static_cast<ShiftRotateOp>(cb_op.y);
-                execute_shift_rotate_op(op, reg);
-            }
-            break;
-            
-        case 1: // BIT b, r8
-            {
-                uint8_t bit = cb_op.y;
-                uint8_t value = read_r8(reg);
-                set_flag_z(!(value & (1 << bit)));
-                set_flag_n(false);
-                set_flag_h(true);
-                // Carry flag unchanged
-            }
-            break;
-            
-        case 2: // RES b, r8
-            {
-                uint8_t bit = cb_op.y;
-                uint8_t value = read_r8(reg);
-                value &= ~(1 << bit);
-                write_r8(reg, value);
-            }
-            break;
-            
-        case 3: // SET b, r8
-            {
-                uint8_t bit = cb_op.y;
-                uint8_t value = read_r8(reg);
-                value |= (1 << bit);
-                write_r8(reg, value);
-            }
-            break;
+//  Instruction Handlers for CB-prefixed opcodes
+template <uint8_t OP>
+uint8_t Cpu::execute_cb()
+{
+    constexpr Opcode op(OP);
+    constexpr R8 reg = static_cast<R8>(op.z);
+    constexpr uint8_t bit = 1 << op.y;
+
+    if constexpr (op.x == 0)
+    {
+        write_r8<reg>(execute_shift_rotate_op<static_cast<ShiftRotateOp>(op.y)>(read_r8<reg>()));
+    }
+    else if constexpr (op.x == 1)
+    {
+        // BIT b, r8
+        set_flag_z(!(read_r8<reg>() & bit));
+        set_flag_n(false);
+        set_flag_h(true);
+        // Carry flag unchanged
+    }
+    else if constexpr (op.x == 2)
+    {
+        write_r8<reg>(read_r8<reg>() & static_cast<uint8_t>(~bit)); // RES b, r8
     }
+    else
+    {
+        write_r8<reg>(read_r8<reg>() | bit); // SET b, r8
+    }
+    return cb_instruction_cycles(OP);
+}
+
+void Cpu::fill_cb_handlers(OpcodeTable& table)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((table[I] = &Cpu::execute_cb<I>), ...);
+    }(std::make_index_sequence<0x100>{});
 }
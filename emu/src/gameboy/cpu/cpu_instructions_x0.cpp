@@ -1,141 +1,111 @@
 #include "cpu.h"
 #include "../bus.h"
+#include <utility>
 
-//  Specific Instruction Handlers for x0 group 
-void Cpu::handle_ld_r16_imm16() {
-    R16_Group1 reg = static_cast<R16_Group1>(opcode.y >> 1);
-    set_r16_group1(reg, fetched_data);
-}
-
-void Cpu::handle_inc_r8() {
-    R8 reg = static_cast<R8>(opcode.y);
-    uint8_t original = read_r8(reg);
-    uint8_t result = original + 1;
-    write_r8(reg, result);
-    set_flags_inc(result, original);
-}
-
-void Cpu::handle_dec_r8() {
-    R8 reg = static_cast<R8>(opcode.y);
-    uint8_t original = read_r8(reg);
-    uint8_t result = original - 1;
-    write_r8(reg, result);
-    set_flags_dec(result, original);
-}
-
-void Cpu::handle_ld_r8_imm8() {
-    R8 reg = static_cast<R8>(opcode.y);
-    write_r8(reg, static_cast<uint8_t>(fetched_data));
-}
-
-void Cpu::handle_inc_r16() {
-    R16_Group1 reg = static_cast<R16_Group1>(opcode.y >> 1);
-    uint16_t value = get_r16_group1(reg);
-    set_r16_group1(reg, value + 1);
-}
+//  Instruction Handlers for x0 group (0x00-0x3F)
+template <uint8_t OP, bool FETCH>
+uint8_t Cpu::execute_x0()
+{
+    constexpr Opcode op(OP);
+    constexpr InstructionInfo info = INSTRUCTION_TABLE[OP];
+    fetch_data<OP, FETCH>();
 
-void Cpu::handle_dec_r16() {
-    R16_Group1 reg = static_cast<R16_Group1>(opcode.y >> 1);
-    uint16_t value = get_r16_group1(reg);
-    set_r16_group1(reg, value - 1);
-}
-
-void Cpu::handle_ld_indirect() {
-    R16_Group2 reg = static_cast<R16_Group2>(opcode.y >> 1);
-    uint16_t addr = get_r16_group2(reg);
-    if (opcode.y & 1)
+    if constexpr (op.z == 0)
+    {
+        if constexpr (op.y == 1)
+        {
+            // LD (a16), SP - store SP at 16-bit address (little-endian)
+            bus->bus_write(fetched_data, regs.sp & 0xFF);
+            bus->bus_write(fetched_data + 1, (regs.sp >> 8) & 0xFF);
+        }
+        else if constexpr (op.y == 3)
+        {
+            regs.pc += static_cast<int8_t>(fetched_data & 0xFF); // JR e8
+        }
+        else if constexpr (op.y >= 4)
+        {
+            // JR conditionals e8
+            static_assert(info.cycles_branch == info.cycles + 1, "JR cc takes one extra cycle when taken");
+            if (check_condition<static_cast<ConditionCode>(op.y & 0b11)>())
+            {
+                regs.pc += static_cast<int8_t>(fetched_data & 0xFF);
+                return info.cycles_branch;
+            }
+        }
+        // NOP and STOP do nothing
+    }
+    else if constexpr (op.z == 1)
+    {
+        constexpr R16_Group1 reg = static_cast<R16_Group1>(op.y >> 1);
+        if constexpr (op.y & 1)
+        {
+            // ADD HL, r16
+            uint16_t hl = get_r16_group1<R16_Group1::HL>();
+            uint16_t value = get_r16_group1<reg>();
+            uint32_t result = hl + value; //Use 32 bit value here since we are dealing with 16 bit register
+            set_flag_n(false);
+            set_flag_h((hl & 0xFFF) + (value & 0xFFF) > 0xFFF);
+            set_flag_c(result > 0xFFFF);
+            set_r16_group1<R16_Group1::HL>(result & 0xFFFF);
+        }
+        else
+        {
+            static_assert(info.imm_size == 2, "LD r16, u16 takes a 16-bit immediate");
+            set_r16_group1<reg>(fetched_data);
+        }
+    }
+    else if constexpr (op.z == 2)
+    {
+        constexpr R16_Group2 reg = static_cast<R16_Group2>(op.y >> 1);
+        if constexpr (op.y & 1)
+            regs.a = bus->bus_read(get_r16_group2<reg>()); // LD A, (r16)
+        else
+            bus->bus_write(get_r16_group2<reg>(), regs.a); // LD (r16), A
+    }
+    else if constexpr (op.z == 3)
+    {
+        constexpr R16_Group1 reg = static_cast<R16_Group1>(op.y >> 1);
+        if constexpr (op.y & 1)
+            r16_group1<reg>()--; // DEC r16
+        else
+            r16_group1<reg>()++; // INC r16
+    }
+    else if constexpr (op.z == 4 || op.z == 5)
+    {
+        constexpr R8 reg = static_cast<R8>(op.y);
+        static_assert(info.cycles == (reg == R8::HL_IND ? 3 : 1), "INC/DEC (HL) adds a read and a write");
+        uint8_t original = read_r8<reg>();
+        if constexpr (op.z == 4)
+        {
+            uint8_t result = original + 1;
+            write_r8<reg>(result);
+            set_flags_inc(result, original);
+        }
+        else
+        {
+            uint8_t result = original - 1;
+            write_r8<reg>(result);
+            set_flags_dec(result, original);
+        }
+    }
+    else if constexpr (op.z == 6)
     {
-        //LD A, (r16)
-        uint8_t value = bus->bus_read(addr);
-        write_r8(R8::A, value);
+        // LD r8, u8
+        constexpr R8 reg = static_cast<R8>(op.y);
+        static_assert(info.imm_size == 1 && info.cycles == (reg == R8::HL_IND ? 3 : 2), "LD r8, u8 table entry");
+        write_r8<reg>(static_cast<uint8_t>(fetched_data));
     }
     else
     {
-        //LD (r16), A
-        uint8_t value = read_r8(R8::A);
-        bus->bus_write(addr, value);
+        execute_acc_flag_op<static_cast<AccFlagOp>(op.y)>();
     }
+    return info.cycles;
 }
 
-// ===== Instruction Group Handler x0 =====
-void Cpu::execute_x0_instructions() {
-    switch (opcode.z) {
-        case 0: 
-            if (opcode.y == 0) 
-            {
-                // NOP
-            }
-            else if (opcode.y == 1)
-            {
-                // LD (a16), SP - store SP at 16-bit address (little-endian)
-                uint8_t lo = regs.sp & 0xFF;
-                uint8_t hi = (regs.sp >> 8) & 0xFF;
-                bus->bus_write(fetched_data, lo);
-                bus->bus_write(fetched_data + 1, hi);
-            }
-            else if (opcode.y == 3)
-            {
-                int8_t tojump = static_cast<int8_t>(fetched_data & 0xFF);
-                regs.pc += tojump;
-            }
-            else //JR conditionals e8
-            {
-                ConditionCode cc = static_cast<ConditionCode>(opcode.y & 0b11);
-                if (check_condition(cc)) {
-                    int8_t offset = static_cast<int8_t>(fetched_data & 0xFF);
-                    regs.pc += offset;
-                    branch_taken = true;
-                }
-            }
-            break;
-            
-        case 1: // LD r16, u16 or ADD HL, r16
-            if (opcode.y & 1) {
-                // ADD HL, r16 (odd y values)
-                R16_Group1 reg = static_cast<R16_Group1>(opcode.y >> 1);
-                uint16_t hl = get_r16_group1(R16_Group1::HL);
-                uint16_t value = get_r16_group1(reg);
-                uint32_t result = hl + value; //Use 32 bit value here since we are dealing with 16 bit register
-                
-                set_flag_n(false);
-                set_flag_h((hl & 0xFFF) + (value & 0xFFF) > 0xFFF);
-                set_flag_c(result > 0xFFFF);
-                set_r16_group1(R16_Group1::HL, result & 0xFFFF);
-            } else {
-                // LD r16, u16 (even y values)
-                handle_ld_r16_imm16();
-            }
-            break;
-            
-        case 2: // LD (r16), A or LD A, (r16)
-            handle_ld_indirect();
-            break;
-            
-        case 3: // INC r16 or DEC r16
-            if (opcode.y & 1) {
-                handle_dec_r16();
-            } else {
-                handle_inc_r16();
-            }
-            break;
-            
-        case 4: // INC r8
-            handle_inc_r8();
-            break;
-            
-        case 5: // DEC r8
-            handle_dec_r8();
-            break;
-            
-        case 6: // LD r8, u8
-            handle_ld_r8_imm8();
-            break;
-            
-        case 7: // Accumulator/flag operations
-            {
-                AccFlagOp op = static_cast<AccFlagOp>(opcode.y);
-                execute_acc_flag_op(op);
-            }
-            break;
-    }
+void Cpu::fill_x0_handlers(OpcodeTable& table, OpcodeTable& decoded_table)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((table[0x00 + I] = &Cpu::execute_x0<0x00 + I, true>), ...);
+        ((decoded_table[0x00 + I] = &Cpu::execute_x0<0x00 + I, false>), ...);
+    }(std::make_index_sequence<0x40>{});
 }
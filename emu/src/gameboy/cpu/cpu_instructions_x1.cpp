@@ -1,20 +1,35 @@
 #include "cpu.h"
 #include "bus.h"
+#include <utility>
 
-//  Specific Instruction Handler for x1 group 
-void Cpu::handle_ld_r8_r8() {
-    R8 dst = static_cast<R8>(opcode.y);
-    R8 src = static_cast<R8>(opcode.z);
-    write_r8(dst, read_r8(src));   
-}
+//  Instruction Handlers for x1 group (0x40-0x7F)
+template <uint8_t OP, bool FETCH>
+uint8_t Cpu::execute_x1()
+{
+    constexpr Opcode op(OP);
+    constexpr InstructionInfo info = INSTRUCTION_TABLE[OP];
+    constexpr R8 dst = static_cast<R8>(op.y);
+    constexpr R8 src = static_cast<R8>(op.z);
+    static_assert(info.imm_size == 0, "x1 group takes no immediate");
 
-//  Instruction Group Handler x1 
-void Cpu::execute_x1_instructions() {
-    if (opcode.z == 6 && opcode.y == 6) 
+    if constexpr (dst == R8::HL_IND && src == R8::HL_IND)
     {
-        // HALT instruction (0x76)
+        // HALT instruction (0x76), takes the place of LD (HL), (HL)
         halted = true;
-        return;
     }
-    handle_ld_r8_r8();
+    else
+    {
+        // LD r8, r8
+        static_assert(info.cycles == ((dst == R8::HL_IND || src == R8::HL_IND) ? 2 : 1), "LD with (HL) adds a memory access");
+        write_r8<dst>(read_r8<src>());
+    }
+    return info.cycles;
+}
+
+void Cpu::fill_x1_handlers(OpcodeTable& table, OpcodeTable& decoded_table)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((table[0x40 + I] = &Cpu::execute_x1<0x40 + I, true>), ...);
+        ((decoded_table[0x40 + I] = &Cpu::execute_x1<0x40 + I, false>), ...);
+    }(std::make_index_sequence<0x40>{});
 }
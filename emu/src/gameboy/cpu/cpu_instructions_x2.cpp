@@ -1,16 +1,24 @@
 #include "cpu.h"
 #include "bus.h"
+#include <utility>
 
-//  Specific Instruction Handler for x2 group 
-void Cpu::handle_alu_r8() {
-    R8 src = static_cast<R8>(opcode.z);
-    AluOp op = static_cast<AluOp>(opcode.y);
-    uint8_t operand = read_r8(src);
-    execute_alu_op(op, operand);
+//  Instruction Handlers for x2 group (0x80-0xBF)
+template <uint8_t OP, bool FETCH>
+uint8_t Cpu::execute_x2()
+{
+    // ALU A, r8
+    constexpr Opcode op(OP);
+    constexpr InstructionInfo info = INSTRUCTION_TABLE[OP];
+    constexpr R8 src = static_cast<R8>(op.z);
+    static_assert(info.imm_size == 0 && info.cycles == (src == R8::HL_IND ? 2 : 1), "ALU A, r8 table entry");
+    execute_alu_op<static_cast<AluOp>(op.y)>(read_r8<src>());
+    return info.cycles;
 }
 
-//  Instruction Group Handler x2 
-void Cpu::execute_x2_instructions() {
-    // ALU A, r8
-    handle_alu_r8();
+void Cpu::fill_x2_handlers(OpcodeTable& table, OpcodeTable& decoded_table)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((table[0x80 + I] = &Cpu::execute_x2<0x80 + I, true>), ...);
+        ((decoded_table[0x80 + I] = &Cpu::execute_x2<0x80 + I, false>), ...);
+    }(std::make_index_sequence<0x40>{});
 }
@@ -1,5 +1,6 @@
 #include "cpu.h"
 #include "bus.h"
+#include <utility>
 
 //  Stack Operations
 uint8_t Cpu::stack_pop8() {
@@ -12,199 +13,181 @@ uint16_t Cpu::stack_pop16() {
     return (static_cast<uint16_t>(high) << 8) | low;
 }
 
-//  Specific Instruction Handlers for x3 group 
-void Cpu::handle_alu_imm8() {
-    AluOp op = static_cast<AluOp>(opcode.y);
-    execute_alu_op(op, static_cast<uint8_t>(fetched_data));
-}
-
-void Cpu::handle_jp_and_interrupts() {
-    switch (opcode.y) {
-        case 0: // JP u16 (unconditional jump)
-            regs.pc = fetched_data;
-            break;
-        case 6: // DI (0xF3) - Disable Interrupts
-            ime = false;
-            ime_delay = false;
-            break;
-        case 7: // EI (0xFB) - Enable Interrupts
-            ime_delay = true; // Enable after next instruction
-            break;
-    }
-}
+//  Instruction Handlers for x3 group (0xC0-0xFF)
+template <uint8_t OP, bool FETCH>
+uint8_t Cpu::execute_x3()
+{
+    constexpr Opcode op(OP);
+    constexpr InstructionInfo info = INSTRUCTION_TABLE[OP];
+    constexpr ConditionCode cc = static_cast<ConditionCode>(op.y & 0b11);
+    fetch_data<OP, FETCH>();
 
-void Cpu::handle_ret_conditional() {
-    ConditionCode cc = static_cast<ConditionCode>(opcode.y);
-    if (check_condition(cc)) 
+    if constexpr (op.z == 0)
     {
-        regs.pc = stack_pop16();
-        branch_taken = true;
-    }
-}
-
-void Cpu::handle_pop_r16() {
-    R16_Group3 reg = static_cast<R16_Group3>(opcode.y >> 1);
-    uint16_t value = stack_pop16();
-    set_r16_group3(reg, value);
-}
-
-void Cpu::handle_push_r16() {
-    R16_Group3 reg = static_cast<R16_Group3>(opcode.y >> 1);
-    uint16_t value = get_r16_group3(reg);
-    stack_push16(value);
-}
-
-void Cpu::handle_call_conditional() {
-    ConditionCode cc = static_cast<ConditionCode>(opcode.y);
-    if (check_condition(cc)) {
-        stack_push16(regs.pc);
-        regs.pc = fetched_data;
-        branch_taken = true;
-    }
-}
-
-//  Instruction Group Handler x3 
-void Cpu::execute_x3_instructions() {
-    switch (opcode.z) {
-        case 0: // RET conditional
-            if (opcode.y < 4) 
-                handle_ret_conditional();
-            
-            else if (opcode.y == 5)
-            {
-                // ADD SP, e8
-                int8_t value = static_cast<int8_t>(fetched_data & 0xFF);
-                uint16_t original = regs.sp;
-                regs.sp += value;
-                set_flag_c(((original & 0xFF) + (value & 0xFF)) > 0xFF); //We check carry on lower byte addition, not full 16 bit
-                set_flag_h(((original & 0x0F) + (value & 0x0F)) > 0x0F);
-                set_flag_n(false);
-                set_flag_z(false);
-            }
-            else if (opcode.y == 6)
-            {
-                //LDH A, (u8)
-                uint8_t addr = static_cast<uint8_t>(fetched_data);
-                uint8_t value = bus->bus_read(0xFF00 + addr);
-                write_r8(R8::A, value);
-            }
-            else if (opcode.y == 7)
-            {
-                //LD HL, SP+e8
-                int8_t offset = static_cast<int8_t>(fetched_data & 0xFF);
-                uint16_t original = regs.sp;
-                set_r16_group1(R16_Group1::HL, original + offset);
-                set_flag_z(false);
-                set_flag_n(false);
-                set_flag_h(((original & 0x0F) + (offset & 0x0F)) > 0x0F);
-                set_flag_c(((original & 0xFF) + (offset & 0xFF)) > 0xFF);
-
-            }
-            else if (opcode.y == 4)
-            {
-                // LD (a8), A
-                uint8_t addr = static_cast<uint8_t>(fetched_data);
-                uint8_t value = read_r8(R8::A);
-                bus->bus_write(0xFF00 + addr, value);
-            }
-
-            break;
-            
-        case 1: // POP r16 or RET/RETI/JP HL
-            if (opcode.y & 1) {
-                // RET, RETI, JP HL, LD SP,HL (odd y)
-                switch (opcode.y >> 1) 
-                {
-                    case 0: // RET (0xC9)
-                        regs.pc = stack_pop16();
-                        break;
-                    case 1: // RETI (0xD9)
-                        regs.pc = stack_pop16();
-                        ime = true;
-                        break;
-                    case 2: // JP HL (0xE9)
-                        regs.pc = get_r16_group1(R16_Group1::HL);
-                        break;
-                    case 3: // LD SP, HL (0xF9)
-                        regs.sp = get_r16_group1(R16_Group1::HL);
-                        break;
-                }
-            } else {
-                // POP r16 (even y)
-                handle_pop_r16();
-            }
-            break;
-            
-        case 2: 
-            if (opcode.y < 4) { // JP conditional
-                ConditionCode cc = static_cast<ConditionCode>(opcode.y);
-                if (check_condition(cc)) {
-                    regs.pc = fetched_data;
-                    branch_taken = true;
-                }
-            }
-            else if (opcode.y == 6)
+        if constexpr (op.y < 4)
+        {
+            // RET cc
+            static_assert(info.cycles_branch == info.cycles + 3, "RET cc pops PC when taken");
+            if (check_condition<cc>())
             {
-                //LD A, (C)
-                uint8_t addr = regs.c;
-                uint8_t value = bus->bus_read(0xFF00 + addr);
-                write_r8(R8::A, value);
+                regs.pc = stack_pop16();
+                return info.cycles_branch;
             }
-            else if (opcode.y == 7)
-            {
-                //LD A, (u16)
-                uint8_t value = bus->bus_read(fetched_data);
-                write_r8(R8::A, value);
-                
-            }
-            else if (opcode.y == 5)
-            {
-                //LD (u16), A
-                uint16_t addr = fetched_data;
-                uint8_t value = read_r8(R8::A);
-                bus->bus_write(addr, value);
-            }
-            else if (opcode.y == 4)
+        }
+        else if constexpr (op.y == 4)
+        {
+            bus->bus_write(0xFF00 + static_cast<uint8_t>(fetched_data), regs.a); // LD (a8), A
+        }
+        else if constexpr (op.y == 5)
+        {
+            // ADD SP, e8
+            int8_t value = static_cast<int8_t>(fetched_data & 0xFF);
+            uint16_t original = regs.sp;
+            regs.sp += value;
+            set_flag_c(((original & 0xFF) + (value & 0xFF)) > 0xFF); //We check carry on lower byte addition, not full 16 bit
+            set_flag_h(((original & 0x0F) + (value & 0x0F)) > 0x0F);
+            set_flag_n(false);
+            set_flag_z(false);
+        }
+        else if constexpr (op.y == 6)
+        {
+            regs.a = bus->bus_read(0xFF00 + static_cast<uint8_t>(fetched_data)); //LDH A, (u8)
+        }
+        else
+        {
+            // LD HL, SP+e8
+            int8_t offset = static_cast<int8_t>(fetched_data & 0xFF);
+            uint16_t original = regs.sp;
+            set_r16_group1<R16_Group1::HL>(original + offset);
+            set_flag_z(false);
+            set_flag_n(false);
+            set_flag_h(((original & 0x0F) + (offset & 0x0F)) > 0x0F);
+            set_flag_c(((original & 0xFF) + (offset & 0xFF)) > 0xFF);
+        }
+    }
+    else if constexpr (op.z == 1)
+    {
+        if constexpr (!(op.y & 1))
+        {
+            set_r16_group3<static_cast<R16_Group3>(op.y >> 1)>(stack_pop16()); // POP r16
+        }
+        else if constexpr (op.y == 1)
+        {
+            regs.pc = stack_pop16(); // RET
+        }
+        else if constexpr (op.y == 3)
+        {
+            regs.pc = stack_pop16(); // RETI
+            ime = true;
+        }
+        else if constexpr (op.y == 5)
+        {
+            regs.pc = get_r16_group1<R16_Group1::HL>(); // JP HL
+        }
+        else
+        {
+            regs.sp = get_r16_group1<R16_Group1::HL>(); // LD SP, HL
+        }
+    }
+    else if constexpr (op.z == 2)
+    {
+        if constexpr (op.y < 4)
+        {
+            // JP cc, u16
+            static_assert(info.imm_size == 2 && info.cycles_branch == info.cycles + 1, "JP cc table entry");
+            if (check_condition<cc>())
             {
-                //LD (C), A
-                uint8_t addr = regs.c;
-                uint8_t value = read_r8(R8::A);
-                bus->bus_write(0xFF00 + addr, value);
-            }
-            break;
-            
-        case 3: // JP and interrupt control
-            handle_jp_and_interrupts();
-            break;
-            
-        case 4: // CALL conditional
-            if (opcode.y < 4) {
-                handle_call_conditional();
-            }
-            break;
-            
-        case 5: // CALL
-            if (opcode.y == 1) {
-                stack_push16(regs.pc);
                 regs.pc = fetched_data;
+                return info.cycles_branch;
             }
-                // Other odd y values: CB prefix or not used
-             else {
-                // PUSH r16 
-                handle_push_r16();
-            }
-            break;
-            
-        case 6: // ALU A, u8
-            handle_alu_imm8();
-            break;
-            
-        case 7: // RST (restart)
+        }
+        else if constexpr (op.y == 4)
+        {
+            bus->bus_write(0xFF00 + regs.c, regs.a); //LD (C), A
+        }
+        else if constexpr (op.y == 5)
+        {
+            bus->bus_write(fetched_data, regs.a); //LD (u16), A
+        }
+        else if constexpr (op.y == 6)
+        {
+            regs.a = bus->bus_read(0xFF00 + regs.c); //LD A, (C)
+        }
+        else
+        {
+            regs.a = bus->bus_read(fetched_data); //LD A, (u16)
+        }
+    }
+    else if constexpr (op.z == 3)
+    {
+        if constexpr (op.y == 0)
+        {
+            regs.pc = fetched_data; // JP u16 (unconditional jump)
+        }
+        else if constexpr (op.y == 1)
+        {
+            // The CB opcode was fetched as the immediate byte, its handler returns the full cycle count including the prefix
+            static_assert(info.imm_size == 1, "CB prefix fetches the CB opcode as its immediate");
+            return (this->*CB_TABLE[static_cast<uint8_t>(fetched_data)])();
+        }
+        else if constexpr (op.y == 6)
+        {
+            // DI (0xF3) - Disable Interrupts
+            ime = false;
+            ime_delay = false;
+        }
+        else if constexpr (op.y == 7)
+        {
+            ime_delay = true; // EI (0xFB) - Enable after next instruction
+        }
+        // Unused opcodes (0xD3, 0xDB, 0xE3, 0xEB) behave as NOP
+    }
+    else if constexpr (op.z == 4)
+    {
+        if constexpr (op.y < 4)
+        {
+            // CALL cc, u16
+            static_assert(info.imm_size == 2 && info.cycles_branch == info.cycles + 3, "CALL cc table entry");
+            if (check_condition<cc>())
             {
-                uint8_t rst_addr = opcode.y * 8;
                 stack_push16(regs.pc);
-                regs.pc = rst_addr;
+                regs.pc = fetched_data;
+                return info.cycles_branch;
             }
-            break;
+        }
+        // Unused opcodes (0xE4, 0xEC, 0xF4, 0xFC) behave as NOP
+    }
+    else if constexpr (op.z == 5)
+    {
+        if constexpr (!(op.y & 1))
+        {
+            stack_push16(get_r16_group3<static_cast<R16_Group3>(op.y >> 1)>()); // PUSH r16
+        }
+        else if constexpr (op.y == 1)
+        {
+            stack_push16(regs.pc); // CALL u16
+            regs.pc = fetched_data;
+        }
+        // Unused opcodes (0xDD, 0xED, 0xFD) behave as NOP
     }
+    else if constexpr (op.z == 6)
+    {
+        static_assert(info.imm_size == 1, "ALU A, u8 takes an 8-bit immediate");
+        execute_alu_op<static_cast<AluOp>(op.y)>(static_cast<uint8_t>(fetched_data));
+    }
+    else
+    {
+        // RST, the restart vector is y * 8
+        stack_push16(regs.pc);
+        regs.pc = op.y * 8;
+    }
+    return info.cycles;
+}
+
+void Cpu::fill_x3_handlers(OpcodeTable& table, OpcodeTable& decoded_table)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((table[0xC0 + I] = &Cpu::execute_x3<0xC0 + I, true>), ...);
+        ((decoded_table[0xC0 + I] = &Cpu::execute_x3<0xC0 + I, false>), ...);
+    }(std::make_index_sequence<0x40>{});
 }
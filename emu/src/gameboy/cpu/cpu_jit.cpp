@@ -0,0 +1,270 @@
+#include "cpu_jit.h"
+#if GAMEBOY_JIT
+#include "cpu_tables.h"
+#include <cstring>
+#include <initializer_list>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    // x86-64 registers used by the translated code, rbx holds the Cpu* for the whole run
+    constexpr uint8_t EAX = 0;
+    constexpr uint8_t ECX = 1;
+    constexpr uint8_t EDX = 2;
+
+    // 8-bit ALU opcodes (r/m8, r8 forms), applied as al op= reg
+    constexpr uint8_t X86_ADD = 0x00;
+    constexpr uint8_t X86_OR = 0x08;
+    constexpr uint8_t X86_AND = 0x20;
+    constexpr uint8_t X86_SUB = 0x28;
+    constexpr uint8_t X86_XOR = 0x30;
+    constexpr uint8_t X86_CMP = 0x38;
+
+    // Most bytes one SM83 instruction can take: an ADC/SBC after an unknown flag state (helper call for C) and its body
+    constexpr size_t MAX_OP_BYTES = 96;
+    constexpr size_t RUN_OVERHEAD = 8; // push rbx; mov rbx, rdi; pop rbx; ret
+
+    // Only the handful of encodings the translator needs, every memory operand is [rbx + disp32]
+    struct Emitter
+    {
+        uint8_t* out;
+        void byte(uint8_t b) { *out++ = b; }
+        void bytes(std::initializer_list<uint8_t> list) { for (uint8_t b : list) byte(b); }
+        void imm32(uint32_t value) { std::memcpy(out, &value, 4); out += 4; }
+        void imm64(uint64_t value) { std::memcpy(out, &value, 8); out += 8; }
+        void rbx_disp(uint8_t reg, int32_t disp) { byte(0x80 | (reg << 3) | 3); imm32(static_cast<uint32_t>(disp)); }
+        void load8(uint8_t reg, int32_t disp) { bytes({0x0F, 0xB6}); rbx_disp(reg, disp); }   // movzx reg, byte [rbx+disp]
+        void store8(uint8_t reg, int32_t disp) { byte(0x88); rbx_disp(reg, disp); }           // mov [rbx+disp], reg8
+        void store_imm8(int32_t disp, uint8_t value) { byte(0xC6); rbx_disp(0, disp); byte(value); }
+        void store_imm16(int32_t disp, uint16_t value)
+        {
+            bytes({0x66, 0xC7});
+            rbx_disp(0, disp);
+            byte(static_cast<uint8_t>(value));
+            byte(static_cast<uint8_t>(value >> 8));
+        }
+        void step16(int32_t disp, bool decrement) { bytes({0x66, 0xFF}); rbx_disp(decrement ? 1 : 0, disp); } // inc/dec word
+        void alu8(uint8_t op, uint8_t src) { byte(op); byte(0xC0 | (src << 3) | EAX); }      // op al, src8
+        void mov_cl_imm8(uint8_t value) { bytes({0xB1, value}); }
+        void call(uint64_t target) { bytes({0x48, 0x89, 0xDF, 0x48, 0xB8}); imm64(target); bytes({0xFF, 0xD0}); } // mov rdi, rbx; mov rax, target; call rax
+    };
+
+    uint8_t flag_op_byte(FlagOp op)
+    {
+        return static_cast<uint8_t>(op);
+    }
+
+    FlagOp alu_flag_op(AluOp op)
+    {
+        switch (op)
+        {
+            case AluOp::ADD: return FlagOp::ADD;
+            case AluOp::ADC: return FlagOp::ADC;
+            case AluOp::SUB: case AluOp::CP: return FlagOp::SUB;
+            case AluOp::SBC: return FlagOp::SBC;
+            case AluOp::AND: return FlagOp::AND;
+            default: return FlagOp::LOGIC;
+        }
+    }
+
+    uint8_t alu_x86_op(AluOp op)
+    {
+        switch (op)
+        {
+            case AluOp::ADD: case AluOp::ADC: return X86_ADD;
+            case AluOp::SUB: case AluOp::SBC: case AluOp::CP: return X86_SUB;
+            case AluOp::AND: return X86_AND;
+            case AluOp::XOR: return X86_XOR;
+            default: return X86_OR;
+        }
+    }
+
+    // Emits one run, tracking the last flag operation so C can usually be derived inline instead of through read_carry
+    class RunTranslator
+    {
+        public:
+            RunTranslator(const JitLayout& layout, uint8_t* out) : layout(layout), e{out} {}
+            uint8_t* end() const { return e.out; }
+            void prologue() { e.bytes({0x53, 0x48, 0x89, 0xFB}); } // push rbx; mov rbx, rdi
+            void epilogue() { e.bytes({0x5B, 0xC3}); }              // pop rbx; ret
+
+            void instruction(uint8_t opcode, uint16_t imm)
+            {
+                uint8_t x = opcode >> 6;
+                uint8_t y = (opcode >> 3) & 0x07;
+                uint8_t z = opcode & 0x07;
+                if (opcode == 0x00)
+                    return; // NOP
+                if (x == 0 && z == 1)
+                    e.store_imm16(layout.r16[y >> 1], imm); // LD r16, u16
+                else if (x == 0 && z == 3)
+                    e.step16(layout.r16[y >> 1], y & 1); // INC/DEC r16, no flags
+                else if (x == 0 && (z == 4 || z == 5))
+                    inc_dec(layout.r8[y], z == 5);
+                else if (x == 0 && z == 6)
+                    e.store_imm8(layout.r8[y], static_cast<uint8_t>(imm)); // LD r8, u8
+                else if (x == 1)
+                {
+                    if (y != z) // LD r8, r8
+                    {
+                        e.load8(EAX, layout.r8[z]);
+                        e.store8(EAX, layout.r8[y]);
+                    }
+                }
+                else if (x == 2)
+                    alu(static_cast<AluOp>(y), false, layout.r8[z], 0);
+                else
+                    alu(static_cast<AluOp>(y), true, 0, static_cast<uint8_t>(imm));
+            }
+
+        private:
+            const JitLayout& layout;
+            Emitter e;
+            bool flags_known = false; // Set once this run has recorded a flag operation of its own
+            FlagOp last_op = FlagOp::NONE;
+
+            // Store the current C (0 or 1) into the carry field, as get_flag_c would return it
+            void carry_to_field()
+            {
+                if (!flags_known || last_op == FlagOp::ADC || last_op == FlagOp::SBC)
+                {
+                    e.call(reinterpret_cast<uint64_t>(layout.read_carry));
+                    e.store8(EAX, layout.flag_carry);
+                    return;
+                }
+                switch (last_op)
+                {
+                    case FlagOp::ADD: // lhs + rhs > 0xFF
+                        e.load8(EAX, layout.flag_lhs);
+                        e.load8(ECX, layout.flag_rhs);
+                        e.bytes({0x01, 0xC8});                   // add eax, ecx
+                        e.byte(0x3D); e.imm32(0xFF);             // cmp eax, 0xFF
+                        e.bytes({0x0F, 0x97, 0xC0});             // seta al
+                        e.store8(EAX, layout.flag_carry);
+                        break;
+                    case FlagOp::SUB: // lhs < rhs
+                        e.load8(EAX, layout.flag_lhs);
+                        e.load8(ECX, layout.flag_rhs);
+                        e.alu8(X86_CMP, ECX);
+                        e.bytes({0x0F, 0x92, 0xC0});             // setb al
+                        e.store8(EAX, layout.flag_carry);
+                        break;
+                    case FlagOp::AND:
+                    case FlagOp::LOGIC:
+                        e.store_imm8(layout.flag_carry, 0);
+                        break;
+                    default: // INC/DEC carried C over, the field already holds it
+                        break;
+                }
+            }
+
+            void record(FlagOp op)
+            {
+                e.store_imm8(layout.flag_op, flag_op_byte(op));
+                flags_known = true;
+                last_op = op;
+            }
+
+            void inc_dec(int32_t reg, bool decrement)
+            {
+                carry_to_field();
+                e.load8(EAX, reg);
+                e.store8(EAX, layout.flag_lhs);
+                e.bytes({0xFE, static_cast<uint8_t>(decrement ? 0xC8 : 0xC0)}); // dec al / inc al
+                e.store8(EAX, reg);
+                e.store8(EAX, layout.flag_result);
+                e.store_imm8(layout.flag_rhs, 1);
+                record(decrement ? FlagOp::DEC : FlagOp::INC);
+            }
+
+            void alu(AluOp op, bool immediate, int32_t reg, uint8_t imm)
+            {
+                bool with_carry = op == AluOp::ADC || op == AluOp::SBC;
+                if (with_carry)
+                {
+                    carry_to_field();
+                    e.load8(EDX, layout.flag_carry);
+                }
+                e.load8(EAX, layout.r8[static_cast<int>(R8::A)]);
+                if (immediate)
+                    e.mov_cl_imm8(imm);
+                else
+                    e.load8(ECX, reg);
+                e.store8(EAX, layout.flag_lhs);
+                e.store8(ECX, layout.flag_rhs);
+                e.alu8(alu_x86_op(op), ECX);
+                if (with_carry)
+                    e.alu8(alu_x86_op(op), EDX); // Carry in
+                if (op != AluOp::CP)
+                    e.store8(EAX, layout.r8[static_cast<int>(R8::A)]);
+                e.store8(EAX, layout.flag_result);
+                if (!with_carry)
+                    e.store_imm8(layout.flag_carry, 0);
+                record(alu_flag_op(op));
+            }
+    };
+}
+
+Jit::Jit(const JitLayout& layout) : layout(layout)
+{
+    void* mem = mmap(nullptr, CODE_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code = (mem == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(mem);
+}
+
+Jit::~Jit()
+{
+    if (code)
+        munmap(code, CODE_SIZE);
+}
+
+void Jit::translate(const std::array<uint8_t, DecodedBlock::MAX_OPS>& opcodes, DecodedBlock& block)
+{
+    for (int i = 0; i < block.count; )
+    {
+        int length = 0;
+        while (i + length < block.count && register_only(opcodes[i + length]))
+            length++;
+        if (length < MIN_RUN)
+        {
+            i += length + 1;
+            continue;
+        }
+        MicroOp& first = block.ops[i];
+        first.native = emit_run(&opcodes[i], &block.ops[i], length);
+        if (!first.native)
+            return;
+        first.native_count = static_cast<uint8_t>(length);
+        first.native_cycles = 0;
+        for (int k = i; k < i + length; k++)
+            first.native_cycles += INSTRUCTION_TABLE[opcodes[k]].cycles; // No branches, so no variable timing
+        i += length;
+    }
+}
+
+MicroOp::NativeFn Jit::emit_run(const uint8_t* opcodes, const MicroOp* ops, int count)
+{
+    size_t size = RUN_OVERHEAD + static_cast<size_t>(count) * MAX_OP_BYTES;
+    if (!code || used + size > CODE_SIZE)
+        return nullptr;
+
+    // Pages are writable only while a run is emitted (W^X). Runs are only emitted from decode_block, never while
+    // translated code is running, so earlier runs sharing the first page are safe to flip
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t first = used & ~(page - 1);
+    size_t last = (used + size + page - 1) & ~(page - 1);
+    if (mprotect(code + first, last - first, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+
+    uint8_t* entry = code + used;
+    RunTranslator run(layout, entry);
+    run.prologue();
+    for (int i = 0; i < count; i++)
+        run.instruction(opcodes[i], ops[i].imm);
+    run.epilogue();
+
+    used += static_cast<size_t>(run.end() - entry);
+    mprotect(code + first, last - first, PROT_READ | PROT_EXEC);
+    __builtin___clear_cache(reinterpret_cast<char*>(entry), reinterpret_cast<char*>(run.end()));
+    return reinterpret_cast<MicroOp::NativeFn>(entry);
+}
+#endif
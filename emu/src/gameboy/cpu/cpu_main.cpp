@@ -3,15 +3,18 @@
 #include "timer.h"
 #include "dma.h"
 #include "ppu.h"
-#include <iostream>
+#include "scheduler.h"
 #include <cstdio>
 #include <interrupts.h>
 #include <thread>
 #include <chrono>
 
-Cpu::Cpu() : bus(nullptr), timer(nullptr), dma(nullptr), ppu(nullptr),
-             fetched_data(0), mem_dest(0), opcode(), halted(false), 
-             stepping(false), ime(false), ime_delay(false), branch_taken(false)
+Cpu::Cpu() : bus(nullptr), timer(nullptr), dma(nullptr), ppu(nullptr), scheduler(nullptr),
+#if GAMEBOY_JIT
+             jit(jit_layout()), // Only takes the addresses of the registers and flags, not their values
+#endif
+             fetched_data(0), mem_dest(0), halted(false),
+             stepping(false), ime(false), ime_delay(false)
 {
     // Initialize all CPU registers to zero
     regs.a = 0;
@@ -47,27 +50,31 @@ bool Cpu::cpu_step()
 
     if (!halted)
     {
-        fetch_instruction();
-        fetch_data();
-        execute_instruction();
-        if (!branch_taken)
-            emu_cycles(INSTRUCTION_TABLE[opcode.whole].cycles);
-        else
-        {
-            emu_cycles(INSTRUCTION_TABLE[opcode.whole].cycles_branch);
-            branch_taken = false; // Reset for next instruction
-        }
+        // One indirect call per instruction, the handler fetches its own immediate and returns the M-cycles it took
+        emu_cycles((this->*OPCODE_TABLE[bus->bus_read(regs.pc++)])());
     }
     else
     {
-        // During HALT, CPU consumes 4 T-cycles per iteration
-        emu_cycles(1);
+        // During HALT, CPU consumes 4 T-cycles per iteration. Interrupts are only raised from scheduled events
+        // (timer overflow, PPU modes/STAT/VBlank, serial transfer), so while IF is clear it stays clear until the next one fires:
+        // jump straight there in whole M-cycles, ending at the same time HALT would have spun to
+        uint64_t deadline = scheduler->get_next_deadline();
+        uint64_t m_cycles = 1;
+        if (halt_skip && !bus->if_register && deadline != Scheduler::NEVER && deadline > scheduler->now)
+            m_cycles = (deadline - scheduler->now + 3) / 4;
+        emu_cycles(static_cast<int>(m_cycles));
         if (bus->if_register)
         {
             halted = false; // Exit halt state if an interrupt is pending
         }
     }
 
+    finish_step(enable_ime_after);
+    return true;
+}
+
+void Cpu::finish_step(bool enable_ime_after)
+{
     if (ime)
     {
         handle_interrupts();
@@ -77,86 +84,12 @@ bool Cpu::cpu_step()
         ime = true;
         ime_delay = false;
     }
-    read_serial_debug();
-    return true;
-}
-
-void Cpu::fetch_data()
-{
-    InstructionInfo info = INSTRUCTION_TABLE[opcode.whole];
-    switch (info.imm_size) 
-    {
-        case 1:
-            fetched_data = read_imm8();
-            break;
-        case 2:
-            fetched_data = read_imm16();
-            break;
-        default:
-            fetched_data = 0;
-            break;
-    }
-}
-
-void Cpu::fetch_instruction()
-{
-    opcode = Opcode(bus->bus_read(regs.pc++));
-}
-
-void Cpu::execute_instruction()
-{
-    // CB-prefixed instructions
-    if (opcode.whole == 0xCB) {
-        execute_cb_instructions();
-        return;
-    }
-    
-    // Dispatch based on x field
-    switch (opcode.x) {
-        case 0:
-            execute_x0_instructions();
-            break;
-        case 1:
-            execute_x1_instructions();
-            break;
-        case 2:
-            execute_x2_instructions();
-            break;
-        case 3:
-            execute_x3_instructions();
-            break;
-    }
-}
-
-void Cpu::read_serial_debug()
-{
-    if (bus->bus_read(0xFF02) == 0x81) 
-     {
-        char c = static_cast<char>(bus->bus_read(0xFF01));
-        bus->serial_buffer += c;
-        if (c == '\n' || bus->serial_buffer.length() >= 128) 
-        {
-            std::cout << bus->serial_buffer;
-            bus->serial_buffer.clear();
-        }
-        bus->bus_write(0xFF02, 0x00); // Clear the transfer start flag
-     }
 }
 
 void Cpu::emu_cycles(int m_cycles)
 {
-    for (int i = 0; i < m_cycles * 4; ++i) 
-    {
-        timer->tick();
-        ppu->ppu_tick();
-    }
-    for (int i = 0; i < m_cycles; ++i) {
-        if (dma->is_active()) {
-            dma->tick();
-        }
-        //std::this_thread::sleep_for(std::chrono::microseconds(1)); // Simulate timing delay, arbitrary value for now
-    }
-    
+    // Timer, PPU and DMA only run when the master clock reaches their next scheduled event
+    scheduler->advance(m_cycles * 4);
 }
 
 void Cpu::request_interrupt(Interrupts::InterruptMask it)
@@ -0,0 +1,26 @@
+#include "cpu.h"
+
+// Both tables point at one template instantiation per opcode, decoded at compile time from the x/y/z opcode fields
+// x = bits 7-6, y = bits 5-3, z = bits 2-0 (see the Opcode struct), each group file fills its own quarter
+
+Cpu::OpcodeTable Cpu::build_opcode_table(bool fetch)
+{
+    OpcodeTable table = {};
+    OpcodeTable decoded_table = {};
+    fill_x0_handlers(table, decoded_table);
+    fill_x1_handlers(table, decoded_table);
+    fill_x2_handlers(table, decoded_table);
+    fill_x3_handlers(table, decoded_table);
+    return fetch ? table : decoded_table;
+}
+
+Cpu::OpcodeTable Cpu::build_cb_table()
+{
+    OpcodeTable table = {};
+    fill_cb_handlers(table);
+    return table;
+}
+
+const Cpu::OpcodeTable Cpu::OPCODE_TABLE = Cpu::build_opcode_table(true);
+const Cpu::OpcodeTable Cpu::DECODED_TABLE = Cpu::build_opcode_table(false);
+const Cpu::OpcodeTable Cpu::CB_TABLE = Cpu::build_cb_table();
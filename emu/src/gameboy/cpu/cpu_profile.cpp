@@ -0,0 +1,45 @@
+#include "cpu_profile.h"
+#include "cpu_tables.h"
+#include <algorithm>
+
+void OpcodeProfiler::record(uint16_t pc, uint8_t opcode)
+{
+    if (pc != expected_pc)
+        run = 0; // Taken branch or interrupt
+    if (run >= 1)
+        pairs[(previous[1] << 8) | opcode]++;
+    if (run >= 2)
+        triples[(previous[0] << 16) | (previous[1] << 8) | opcode]++;
+    previous[0] = previous[1];
+    previous[1] = opcode;
+    run = std::min(run + 1, 2);
+    expected_pc = pc + INSTRUCTION_TABLE[opcode].length;
+    instructions++;
+}
+
+static std::vector<OpcodeProfiler::Sequence> most_frequent(std::vector<OpcodeProfiler::Sequence> sequences, std::size_t n)
+{
+    n = std::min(n, sequences.size());
+    std::partial_sort(sequences.begin(), sequences.begin() + n, sequences.end(),
+                      [](const auto& a, const auto& b) { return a.count > b.count; });
+    sequences.resize(n);
+    return sequences;
+}
+
+std::vector<OpcodeProfiler::Sequence> OpcodeProfiler::top_pairs(std::size_t n) const
+{
+    std::vector<Sequence> sequences;
+    for (uint32_t i = 0; i < pairs.size(); i++) {
+        if (pairs[i])
+            sequences.push_back({i, pairs[i]});
+    }
+    return most_frequent(std::move(sequences), n);
+}
+
+std::vector<OpcodeProfiler::Sequence> OpcodeProfiler::top_triples(std::size_t n) const
+{
+    std::vector<Sequence> sequences;
+    for (const auto& [opcodes, count] : triples)
+        sequences.push_back({opcodes, count});
+    return most_frequent(std::move(sequences), n);
+}
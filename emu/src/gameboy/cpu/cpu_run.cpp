@@ -0,0 +1,410 @@
+#include "cpu.h"
+#include "bus.h"
+#include "ppu.h"
+#include "memory_map.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <utility>
+
+// True for a JR/JP (conditional or not) to target, JP (HL) and every other branch are not followed
+static bool branches_to(uint8_t opcode, const MicroOp& op, uint16_t target)
+{
+    switch (opcode)
+    {
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+            return static_cast<uint16_t>(op.next_pc + static_cast<int8_t>(op.imm)) == target;
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: // JP
+            return op.imm == target;
+        default:
+            return false;
+    }
+}
+
+DecodedBlock* Cpu::find_block(uint16_t pc)
+{
+    if (pc > MemoryMap::ROM_BANK_NN_END)
+        return nullptr; // Code in RAM can change under us, only ROM is cached
+    int bank = bus->rom_bank(pc);
+    if (bank < 0)
+        return nullptr;
+    DecodedBlock* block = block_cache.find(static_cast<uint16_t>(bank), pc);
+    if (!block)
+    {
+        block = &block_cache.insert(static_cast<uint16_t>(bank), pc);
+        decode_block(pc, *block);
+    }
+    return block->count ? block : nullptr;
+}
+
+void Cpu::decode_block(uint16_t pc, DecodedBlock& block)
+{
+    // Instructions may not cross into the next 16 KiB region, it can hold a different bank
+    uint32_t region_end = (pc & ~(BlockCache::BANK_SIZE - 1)) + BlockCache::BANK_SIZE;
+    uint16_t addr = pc;
+    bool idle_body = true; // Every instruction so far may be part of an idle loop
+    std::array<uint8_t, DecodedBlock::MAX_OPS> opcodes = {};
+    while (block.count < DecodedBlock::MAX_OPS)
+    {
+        uint8_t opcode = bus->bus_read(addr);
+        const InstructionInfo& info = INSTRUCTION_TABLE[opcode];
+        uint16_t next_pc = addr + 1 + info.imm_size; // STOP's padding byte is not skipped
+        if (next_pc > region_end)
+            break;
+
+        opcodes[block.count] = opcode;
+        MicroOp& op = block.ops[block.count++];
+        op.imm = 0;
+        if (info.imm_size == 1)
+            op.imm = bus->bus_read(addr + 1);
+        else if (info.imm_size == 2)
+            op.imm = bus->bus_read(addr + 1) | (bus->bus_read(addr + 2) << 8);
+        op.handler = (opcode == 0xCB) ? CB_TABLE[op.imm] : DECODED_TABLE[opcode]; // Skip the prefix handler
+        op.next_pc = next_pc;
+
+        if (ends_basic_block(opcode))
+        {
+            if (branches_to(opcode, op, pc))
+            {
+                block.idle_loop = idle_body;
+                match_bulk_loop(opcodes, block);
+            }
+            break;
+        }
+        PollSource source = idle_loop_source(opcode, static_cast<uint8_t>(op.imm));
+        if (source == PollSource::INVALID || (source != PollSource::NONE && block.poll_count == DecodedBlock::MAX_POLLS))
+            idle_body = false;
+        else if (source != PollSource::NONE)
+            block.polls[block.poll_count++] = {source, op.imm};
+        addr = next_pc;
+    }
+
+#if GAMEBOY_JIT
+    jit.translate(opcodes, block);
+#endif
+
+    // Superinstructions, matched left to right over what the translator left
+    for (int i = 0; i < block.count; )
+    {
+        int available = block.count - i;
+#if GAMEBOY_JIT
+        if (block.ops[i].native)
+        {
+            i += block.ops[i].native_count;
+            continue;
+        }
+        for (int k = i + 1; k < block.count; k++)
+        {
+            if (block.ops[k].native)
+            {
+                available = k - i;
+                break;
+            }
+        }
+#endif
+        int sequence = fused_sequence(&opcodes[i], available);
+        if (sequence < 0)
+        {
+            i++;
+            continue;
+        }
+        int length = FUSED_SEQUENCES[sequence].length;
+        int cycles = 0;
+        for (int k = i; k < i + length; k++)
+        {
+            const InstructionInfo& info = INSTRUCTION_TABLE[opcodes[k]];
+            cycles += std::max(info.cycles, info.cycles_branch);
+        }
+        block.ops[i].fused = static_cast<uint8_t>(length);
+        block.ops[i].fused_sequence = static_cast<uint8_t>(sequence);
+        block.ops[i].fused_cycles = static_cast<uint8_t>(cycles);
+        i += length;
+    }
+}
+
+uint64_t Cpu::run_block(const DecodedBlock& block, uint64_t frame_target)
+{
+    uint32_t rom_map = bus->rom_map_generation;
+    uint64_t executed = 0;
+    for (uint8_t i = 0; i < block.count; )
+    {
+        const MicroOp& op = block.ops[i];
+#if GAMEBOY_JIT
+        if (op.native && can_batch(op.native_cycles))
+        {
+            executed += op.native_count;
+            i += op.native_count;
+            native_stats.runs++;
+            native_stats.instructions += op.native_count;
+            if (!run_native(op, rom_map, frame_target))
+                break;
+            continue;
+        }
+#endif
+        // A superinstruction skips the tail between its instructions, so it only runs when nothing could happen there
+        if (op.fused && can_batch(op.fused_cycles))
+        {
+            executed += op.fused;
+            i += op.fused;
+            fused_stats.dispatches++;
+            fused_stats.instructions += op.fused;
+            if (!run_fused(op, rom_map, frame_target))
+                break;
+            continue;
+        }
+        executed++;
+        i++;
+        if (!run_micro_op(op, rom_map, frame_target))
+            break;
+    }
+    return executed;
+}
+
+bool Cpu::can_batch(uint8_t m_cycles) const
+{
+    return !ime_delay && !(ime && (bus->if_register & bus->ie_register & 0x1F))
+        && scheduler->now + m_cycles * 4u <= scheduler->get_next_deadline();
+}
+
+// The members' opcodes are template arguments, so a superinstruction is one dispatch through FUSED_TABLE followed by
+// direct calls to each member's handler, with the cycles still charged per instruction
+template <std::size_t SEQ>
+void Cpu::execute_fused(const MicroOp* ops)
+{
+    constexpr FusedSequence sequence = FUSED_SEQUENCES[SEQ];
+    [&]<std::size_t... K>(std::index_sequence<K...>) {
+        ((regs.pc = ops[K].next_pc, fetched_data = ops[K].imm, emu_cycles(execute_opcode<sequence.opcodes[K], false>())), ...);
+    }(std::make_index_sequence<sequence.length>{});
+}
+
+Cpu::FusedTable Cpu::build_fused_table()
+{
+    FusedTable table = {};
+    [&]<std::size_t... SEQ>(std::index_sequence<SEQ...>) {
+        ((table[SEQ] = &Cpu::execute_fused<SEQ>), ...);
+    }(std::make_index_sequence<std::size(FUSED_SEQUENCES)>{});
+    return table;
+}
+
+const Cpu::FusedTable Cpu::FUSED_TABLE = Cpu::build_fused_table();
+
+bool Cpu::run_fused(const MicroOp& op, uint32_t rom_map, uint64_t frame_target)
+{
+    (this->*FUSED_TABLE[op.fused_sequence])(&op);
+    finish_step(false);
+    const MicroOp& last = (&op)[op.fused - 1];
+    return regs.pc == last.next_pc && !halted && bus->rom_map_generation == rom_map && ppu->frame_count < frame_target;
+}
+
+#if GAMEBOY_JIT
+JitLayout Cpu::jit_layout()
+{
+    auto offset = [this](const void* field) {
+        return static_cast<int32_t>(reinterpret_cast<const char*>(field) - reinterpret_cast<const char*>(this));
+    };
+    JitLayout layout;
+    layout.r8 = {offset(&regs.b), offset(&regs.c), offset(&regs.d), offset(&regs.e),
+                 offset(&regs.h), offset(&regs.l), 0, offset(&regs.a)};
+    layout.r16 = {offset(&regs.bc), offset(&regs.de), offset(&regs.hl), offset(&regs.sp)};
+    layout.flag_op = offset(&pending_flags.op);
+    layout.flag_lhs = offset(&pending_flags.lhs);
+    layout.flag_rhs = offset(&pending_flags.rhs);
+    layout.flag_carry = offset(&pending_flags.carry);
+    layout.flag_result = offset(&pending_flags.result);
+    layout.read_carry = &Cpu::jit_read_carry;
+    return layout;
+}
+
+uint8_t Cpu::jit_read_carry(Cpu* cpu)
+{
+    return cpu->get_flag_c() ? 1 : 0;
+}
+
+// The run only touches registers and flags, so its cycles can all be charged after it: can_batch has checked that
+// no event falls inside it, and nothing it does reads the clock
+bool Cpu::run_native(const MicroOp& op, uint32_t rom_map, uint64_t frame_target)
+{
+    op.native(this);
+    const MicroOp& last = (&op)[op.native_count - 1];
+    regs.pc = last.next_pc;
+    fetched_data = last.imm;
+    emu_cycles(op.native_cycles);
+    finish_step(false);
+    return regs.pc == last.next_pc && !halted && bus->rom_map_generation == rom_map && ppu->frame_count < frame_target;
+}
+#endif
+
+bool Cpu::run_micro_op(const MicroOp& op, uint32_t rom_map, uint64_t frame_target)
+{
+    bool enable_ime_after = ime_delay; // EI effect happens after the NEXT instruction
+    regs.pc = op.next_pc;
+    fetched_data = op.imm;
+    emu_cycles((this->*op.handler)());
+    finish_step(enable_ime_after);
+    // Leave on a taken branch, an interrupt, HALT, a bank switch (the rest of the block may be another bank's code)
+    // or the end of the run, the next lookup picks the right block
+    return regs.pc == op.next_pc && !halted && bus->rom_map_generation == rom_map && ppu->frame_count < frame_target;
+}
+
+// Memory that only changes through CPU stores (an idle loop makes none) or scheduled events: PPU modes and LY,
+// DMA into OAM, IF. DIV/TIMA count between events, joypad, serial, audio and cartridge RAM are left out
+static bool poll_address_stable(uint16_t address)
+{
+    if (address < MemoryMap::IO_START)
+        return !MemoryMap::is_eram(address); // ROM, VRAM, WRAM, echo RAM, OAM
+    return address == MemoryMap::IF_REGISTER || MemoryMap::is_lcd(address) || MemoryMap::is_hram(address);
+}
+
+uint64_t Cpu::run_idle_loop(const DecodedBlock& block, uint64_t frame_target)
+{
+    // Run one iteration normally. If it came back to the loop head with A, F and IME as they were and no event fired
+    // in between, the next iteration reads the same memory and does the same thing again, up to the next event
+    uint16_t head = regs.pc;
+    uint8_t a = regs.a;
+    uint8_t f = read_f();
+    bool was_ime_delay = ime_delay;
+    uint64_t start = scheduler->now;
+    uint64_t deadline = scheduler->get_next_deadline();
+    uint64_t executed = run_block(block, frame_target);
+    if (regs.pc != head || regs.a != a || read_f() != f || was_ime_delay || ime_delay || halted
+        || deadline == Scheduler::NEVER || scheduler->now >= deadline)
+        return executed;
+    for (uint8_t i = 0; i < block.poll_count; i++)
+    {
+        const IdlePoll& poll = block.polls[i];
+        uint16_t address = poll.imm;
+        switch (poll.source)
+        {
+            case PollSource::BC: address = regs.bc; break;
+            case PollSource::DE: address = regs.de; break;
+            case PollSource::HL: address = regs.hl; break;
+            case PollSource::IO_C: address = 0xFF00 + regs.c; break;
+            case PollSource::IO_IMM8: address = 0xFF00 + static_cast<uint8_t>(poll.imm); break;
+            default: break;
+        }
+        if (!poll_address_stable(address))
+            return executed;
+    }
+
+    // Skip the whole iterations that end before the deadline, the event then fires inside a real iteration
+    uint64_t iteration = scheduler->now - start;
+    uint64_t skipped = (deadline - 1 - scheduler->now) / iteration;
+    if (skipped == 0)
+        return executed;
+    scheduler->now += skipped * iteration; // Stays below next_deadline, nothing to dispatch
+    idle_stats.hits++;
+    idle_stats.t_cycles += skipped * iteration;
+    return executed + skipped * block.count;
+}
+
+// Idle loops, copy/fill loops and the rest of the ROM blocks, shared by both cpu_run builds
+uint64_t Cpu::run_block_front_end(const DecodedBlock& block, uint64_t frame_target)
+{
+    if (block.idle_loop && idle_skip)
+        return run_idle_loop(block, frame_target);
+    if (block.bulk.source != BulkSource::NONE)
+        return run_bulk_loop(block, frame_target);
+    return run_block(block, frame_target);
+}
+
+#if GAMEBOY_THREADED_DISPATCH
+// Labels-as-values (GCC/Clang): every opcode gets its own label that ends in its own indirect jump to the next
+// opcode, so the branch predictor sees one dispatch site per opcode instead of the single call site in cpu_step
+#define OPCODE_ROW(M, hi) \
+    M(hi##0) M(hi##1) M(hi##2) M(hi##3) M(hi##4) M(hi##5) M(hi##6) M(hi##7) \
+    M(hi##8) M(hi##9) M(hi##A) M(hi##B) M(hi##C) M(hi##D) M(hi##E) M(hi##F)
+#define FOR_EACH_OPCODE(M) \
+    OPCODE_ROW(M, 0x0) OPCODE_ROW(M, 0x1) OPCODE_ROW(M, 0x2) OPCODE_ROW(M, 0x3) \
+    OPCODE_ROW(M, 0x4) OPCODE_ROW(M, 0x5) OPCODE_ROW(M, 0x6) OPCODE_ROW(M, 0x7) \
+    OPCODE_ROW(M, 0x8) OPCODE_ROW(M, 0x9) OPCODE_ROW(M, 0xA) OPCODE_ROW(M, 0xB) \
+    OPCODE_ROW(M, 0xC) OPCODE_ROW(M, 0xD) OPCODE_ROW(M, 0xE) OPCODE_ROW(M, 0xF)
+
+#define OPCODE_LABEL_ADDRESS(op) &&op_##op,
+
+// Same per-instruction tail as cpu_step, then fetch and jump straight to the next opcode's label.
+// HALT, the end of the run and a jump back into ROM return to the block front end at the top of the loop.
+#define DISPATCH()                                                             \
+    if (ime && (bus->if_register & bus->ie_register & 0x1F))                   \
+        handle_interrupts();                                                   \
+    if (enable_ime_after) {                                                    \
+        ime = true;                                                            \
+        ime_delay = false;                                                     \
+    }                                                                          \
+    instructions++;                                                            \
+    if (halted || ppu->frame_count >= frame_target                             \
+        || regs.pc <= MemoryMap::ROM_BANK_NN_END)                              \
+        goto step;                                                             \
+    enable_ime_after = ime_delay;                                              \
+    goto *dispatch_table[bus->bus_read(regs.pc++)];
+
+#define OPCODE_BODY(op)                                                        \
+    op_##op:                                                                   \
+    emu_cycles(execute_opcode<op, true>());                                    \
+    DISPATCH()
+
+// ROM code goes through the same block front end as the handler table build (block cache, idle skip, bulk loops,
+// superinstructions), the labels only replace cpu_step for code that has no block: RAM and the bootrom
+uint64_t Cpu::cpu_run(uint64_t frame_target)
+{
+    static void* const dispatch_table[256] = { FOR_EACH_OPCODE(OPCODE_LABEL_ADDRESS) };
+    uint64_t instructions = 0;
+    bool enable_ime_after = false;
+
+step:
+    if (ppu->frame_count >= frame_target)
+        return instructions;
+    if (halted)
+    {
+        cpu_step(); // HALT iterations are not instructions
+        goto step;
+    }
+    if (DecodedBlock* block = find_block(regs.pc))
+    {
+        instructions += run_block_front_end(*block, frame_target);
+        goto step;
+    }
+    enable_ime_after = ime_delay; // EI effect happens after the NEXT instruction
+    goto *dispatch_table[bus->bus_read(regs.pc++)];
+
+    FOR_EACH_OPCODE(OPCODE_BODY)
+}
+
+const char* Cpu::dispatch_mode()
+{
+#if GAMEBOY_JIT
+    return "ROM block cache, x86-64 register-only runs, computed goto outside ROM";
+#else
+    return "ROM block cache, computed goto outside ROM";
+#endif
+}
+
+#else
+
+uint64_t Cpu::cpu_run(uint64_t frame_target)
+{
+    uint64_t instructions = 0;
+    while (ppu->frame_count < frame_target)
+    {
+        if (DecodedBlock* block = halted ? nullptr : find_block(regs.pc))
+        {
+            instructions += run_block_front_end(*block, frame_target);
+            continue;
+        }
+        // RAM code, the bootrom and HALT go one instruction at a time
+        bool was_halted = halted;
+        cpu_step();
+        if (!was_halted)
+            instructions++; // HALT iterations are not instructions
+    }
+    return instructions;
+}
+
+const char* Cpu::dispatch_mode()
+{
+#if GAMEBOY_JIT
+    return "ROM block cache, x86-64 register-only runs, handler table outside ROM";
+#else
+    return "ROM block cache, handler table outside ROM";
+#endif
+}
+
+#endif
@@ -1,11 +1,25 @@
 #include "dma.h"
+#include "scheduler.h"
+
+uint8_t DMA::read(uint16_t /*address*/)
+{
+    return 0xFF; // Not readable in this implementation
+}
+
+void DMA::write(uint16_t /*address*/, uint8_t value)
+{
+    start(value);
+}
 
 void DMA::start(uint8_t value)
 {
+    sync(); // Finish the M-cycles of a transfer that is already running
     ctx.active = true;
     ctx.start_addr = value;
     ctx.current_iter = 0;
     ctx.start_delay = 1; // We are using one because we tick DMA in m-cycles
+    last_sync = scheduler->now;
+    scheduler->schedule(SchedulerEvent::DMA, last_sync + 4);
 }
 
 void DMA::tick()
@@ -32,3 +46,17 @@ bool DMA::is_active() const
 {
     return ctx.active;
 }
+
+void DMA::sync()
+{
+    if (!ctx.active) {
+        return;
+    }
+    uint64_t m_cycles = (scheduler->now - last_sync) / 4;
+    last_sync += m_cycles * 4;
+    for (uint64_t i = 0; i < m_cycles && ctx.active; i++) {
+        tick();
+    }
+    if (ctx.active)
+        scheduler->schedule(SchedulerEvent::DMA, last_sync + 4);
+}
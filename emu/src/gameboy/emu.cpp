@@ -13,7 +13,6 @@ Emu::Emu(const std::string &rom_filename, const std::string &bootrom_filename)
       dma(),
       lcd()
 {
-    ctx.paused = false;
     ctx.running = true;
     ctx.ticks = 0;
     rom = create_cartridge(rom_filename, bootrom_filename);
@@ -26,7 +25,6 @@ Emu::Emu(bool test_mode_enable)
       dma(),
       lcd()
 {
-    ctx.paused = false;
     ctx.running = true;
     ctx.ticks = 0;
     //  Will create a dummy ROM for test mode
@@ -59,12 +57,34 @@ ROM* Emu::create_cartridge(const std::string &filename, const std::string& bootr
     return romptr;
 }
 
+void Emu::skip_bootrom()
+{
+    // Register values left behind by the DMG bootrom (see Pandocs "Power Up Sequence")
+    rom->disable_bootrom();
+    bus.map_rom_pages();
+    cpu.regs.a = 0x01;
+    cpu.write_f(0xB0);
+    cpu.regs.b = 0x00;
+    cpu.regs.c = 0x13;
+    cpu.regs.d = 0x00;
+    cpu.regs.e = 0xD8;
+    cpu.regs.h = 0x01;
+    cpu.regs.l = 0x4D;
+    cpu.regs.sp = 0xFFFE;
+    cpu.regs.pc = 0x0100;
+    bus.bus_write(0xFF40, 0x91); // LCDC
+    bus.bus_write(0xFF47, 0xFC); // BGP
+}
+
 void Emu::set_component_pointers()
 {
-  cpu.set_cmp(&bus, &timer, &dma, &ppu);
+  scheduler.set_cmp(&timer, &ppu, &dma, &serial);
+  cpu.set_cmp(&bus, &timer, &dma, &ppu, &scheduler);
   bus.set_cmp(rom, &timer, &ppu, &dma, &lcd);
-  timer.set_cmp(&bus);
-  ppu.set_cmp(&bus, &lcd, &cpu);
-  dma.set_cmp(&bus);
-  lcd.set_cmp(&ppu, &cpu);
+  timer.set_cmp(&bus, &scheduler);
+  ppu.set_cmp(&bus, &lcd, &cpu, &scheduler);
+  dma.set_cmp(&bus, &scheduler);
+  lcd.set_cmp(&bus, &ppu, &cpu);
+  serial.set_cmp(&bus, &scheduler);
+  bus.init_page_table(); // Needs the ROM and PPU pointers
 }
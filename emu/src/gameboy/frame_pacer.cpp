@@ -0,0 +1,69 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <thread>
+
+void FramePacer::set_speed(double multiplier)
+{
+    if (multiplier != UNLIMITED)
+        multiplier = std::clamp(multiplier, MIN_SPEED, MAX_SPEED);
+    speed.store(multiplier, std::memory_order_relaxed);
+}
+
+void FramePacer::set_paused(bool pause)
+{
+    {
+        std::lock_guard<std::mutex> lock(pause_mutex);
+        paused = pause;
+    }
+    pause_cv.notify_all();
+}
+
+bool FramePacer::is_paused()
+{
+    std::lock_guard<std::mutex> lock(pause_mutex);
+    return paused;
+}
+
+void FramePacer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(pause_mutex);
+        stopped = true;
+    }
+    pause_cv.notify_all();
+}
+
+bool FramePacer::wait_frame()
+{
+    {
+        std::unique_lock<std::mutex> lock(pause_mutex);
+        if (paused)
+        {
+            pause_cv.wait(lock, [this]() { return !paused || stopped; });
+            restart = true; // Time spent paused is not made up afterwards
+        }
+        if (stopped)
+            return false;
+    }
+
+    double multiplier = get_speed();
+    clock::time_point now = clock::now();
+    if (multiplier == UNLIMITED)
+    {
+        restart = true;
+        return true;
+    }
+    auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / (FRAME_RATE * multiplier)));
+    if (restart || now - deadline > period * MAX_FRAMES_BEHIND)
+    {
+        deadline = now; // The frame just emulated counts as on time
+        restart = false;
+    }
+    // Deadlines are absolute, so the error of one sleep is not carried into the next frame
+    deadline += period;
+    if (deadline - now > SPIN_MARGIN)
+        std::this_thread::sleep_until(deadline - SPIN_MARGIN);
+    while (clock::now() < deadline)
+        std::this_thread::yield();
+    return true;
+}
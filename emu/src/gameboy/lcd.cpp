@@ -2,14 +2,18 @@
 #include "interrupts.h"
 #include "cpu.h"
 
-LCD::LCD() : regs{}, ppu(nullptr)
+LCD::LCD() : regs{}, bus(nullptr), ppu(nullptr)
 {
 }
 
-void LCD::set_cmp(Ppu *ppu_ptr, Cpu* cpu_ptr)
+void LCD::set_cmp(Bus* bus_ptr, Ppu *ppu_ptr, Cpu* cpu_ptr)
 {
+    bus = bus_ptr;
     ppu = ppu_ptr;
     cpu = cpu_ptr;
+    // FF46 in between belongs to DMA
+    bus->map_io<&LCD::lcd_read, &LCD::lcd_write>(0xFF40, 0xFF45, this);
+    bus->map_io<&LCD::lcd_read, &LCD::lcd_write>(0xFF47, MemoryMap::LCD_END, this);
 }
 
 void LCD::lcd_write(uint16_t addr, uint8_t value)
@@ -18,6 +22,7 @@ void LCD::lcd_write(uint16_t addr, uint8_t value)
     {
         case 0xFF40: // LCD Control
             byte_to_lcd_control(regs.lcd_control, value);
+            bus->map_vram_pages(); // Turning the LCD off or on changes whether VRAM can be locked
             break;
         case 0xFF41: // LCD Status
             byte_to_lcd_status(regs.lcd_status, value);
@@ -37,8 +42,6 @@ void LCD::lcd_write(uint16_t addr, uint8_t value)
             regs.lcd_y_compare = value;
             check_lyc();
             break;
-        case 0xFF46: // DMA handled in bus component
-            break;
         case 0xFF47: // BGP
             regs.bg_palette = value;
             break;
@@ -76,8 +79,6 @@ uint8_t LCD::lcd_read(uint16_t addr) const
             return regs.lcd_y;
         case 0xFF45: // LYC
             return regs.lcd_y_compare;
-        case 0xFF46: // DMA
-            return 0xFF; // Not readable from LCD usually
         case 0xFF47: // BGP
             return regs.bg_palette;
         case 0xFF48: // OBP0
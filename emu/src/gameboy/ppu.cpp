@@ -4,61 +4,122 @@
 #include "lcd.h"
 #include "interrupts.h"
 #include "cpu.h"
+#include "scheduler.h"
+#include "bus.h"
+#include "tile_decode.h"
 #include <mutex>
 #include <algorithm>
+#include <bit>
 class LCD;
 
-Ppu::Ppu() : bus(nullptr), lcd(nullptr), cpu(nullptr), dot(0)
+Ppu::Ppu() : bus(nullptr), lcd(nullptr), cpu(nullptr), scheduler(nullptr), dot(0)
 {
     // Initialize both VRAM buffers to 0
     std::memset(&vram_buffers[0], 0, sizeof(vram_layout));
     std::memset(&vram_buffers[1], 0, sizeof(vram_layout));
+    std::fill(std::begin(tile_generation), std::end(tile_generation), 1); // Ahead of every cache stamp, so all start stale
     // Screen buffers are already initialized to 0 by their declarations
 }
 
 void Ppu::swap_buffers()
 {
-    // Lock mutex to prevent rendering thread from reading during swap
-    // Copy both to front buffer (better than pointer swap because rendering thread may be mid-read on one buffer)
-    std::lock_guard<std::mutex> screen_lock(screen_mutex);
-    std::memcpy(screen_front, screen_back, PpuConstants::SCREEN_BUFFER_SIZE);
+    // Trade the front buffer for the shared one only if the PPU has put a new frame there since the last pickup,
+    // otherwise the renderer would get back the frame it just gave away
+    if (screen_shared.load(std::memory_order_relaxed) & FRESH_FRAME)
+    {
+        screen_front_index = screen_shared.exchange(screen_front_index, std::memory_order_acq_rel) & ~FRESH_FRAME;
+        screen_front = screen_buffers[screen_front_index];
+    }
     #ifdef ENABLE_DEBUG_VIEWERS
         std::lock_guard<std::mutex> vram_lock(vram_mutex);
         std::memcpy(vram_front, vram_back, sizeof(vram_layout));
     #endif
 }
 
-void Ppu::set_cmp(Bus *bus_ptr, LCD* lcd_ptr, Cpu* cpu_ptr)
+void Ppu::publish_frame()
+{
+    // The release half makes every pixel of the frame visible to the renderer before the index is
+    screen_back_index = screen_shared.exchange(screen_back_index | FRESH_FRAME, std::memory_order_acq_rel) & ~FRESH_FRAME;
+    screen_back = screen_buffers[screen_back_index];
+}
+
+void Ppu::set_cmp(Bus *bus_ptr, LCD* lcd_ptr, Cpu* cpu_ptr, Scheduler* scheduler_ptr)
 {
     bus = bus_ptr;
     lcd = lcd_ptr;
     cpu = cpu_ptr;
+    scheduler = scheduler_ptr;
+    last_sync = scheduler->now;
+    scheduler->schedule(SchedulerEvent::PPU, last_sync + dots_to_next_boundary());
 }
 
-void Ppu::ppu_tick()
+uint16_t Ppu::dots_to_next_boundary() const
 {
-    dot++;
+    // The mode handlers only act once dot reaches the end of the current mode
+    uint16_t boundary = PpuConstants::DOTS_PER_SCANLINE;
     switch (static_cast<LCD_Modes>(lcd->regs.lcd_status.mode_flag))
     {
         case LCD_Modes::OAM_SEARCH:
-            handle_oam_search();
+            boundary = PpuConstants::OAM_SEARCH_DOTS;
             break;
         case LCD_Modes::PIXEL_TRANSFER:
-            handle_pixel_transfer();
+            boundary = PpuConstants::OAM_SEARCH_DOTS + PpuConstants::PIXEL_TRANSFER_DOTS;
             break;
         case LCD_Modes::HBLANK:
-            handle_hblank();
-            break;
         case LCD_Modes::VBLANK:
-            handle_vblank();
             break;
     }
+    return (dot < boundary) ? boundary - dot : 1;
+}
+
+void Ppu::sync()
+{
+    uint64_t elapsed = scheduler->now - last_sync;
+    last_sync = scheduler->now;
+    advance(elapsed);
+    scheduler->schedule(SchedulerEvent::PPU, last_sync + dots_to_next_boundary());
+}
+
+void Ppu::advance(uint64_t dots)
+{
+    // Nothing observable happens between mode boundaries, so jump dot straight to the next one and run its handler there
+    while (dots > 0)
+    {
+        uint16_t step = dots_to_next_boundary();
+        if (dots < step)
+        {
+            dot += static_cast<uint16_t>(dots);
+            return;
+        }
+        dot += step;
+        dots -= step;
+        switch (static_cast<LCD_Modes>(lcd->regs.lcd_status.mode_flag))
+        {
+            case LCD_Modes::OAM_SEARCH:
+                handle_oam_search();
+                break;
+            case LCD_Modes::PIXEL_TRANSFER:
+                handle_pixel_transfer();
+                break;
+            case LCD_Modes::HBLANK:
+                handle_hblank();
+                break;
+            case LCD_Modes::VBLANK:
+                handle_vblank();
+                break;
+        }
+    }
 }
 
 void Ppu::handle_oam_search()
 {
     if (dot >= PpuConstants::OAM_SEARCH_DOTS)
     {
+        if (!lcd->regs.lcd_control.lcd_enable) // LCD off: keep LY and mode timing but skip the OAM scan
+        {
+            lcd->set_mode(LCD_Modes::PIXEL_TRANSFER);
+            return;
+        }
         // Snapshot scroll and LY at the exact moment we enter pixel transfer
         sst.scy = lcd->regs.scroll_y;
         sst.scx = lcd->regs.scroll_x;
@@ -69,30 +130,28 @@ void Ppu::handle_oam_search()
         sst.objs_enabled = lcd->get_lcd_control_attr(lcd_control_bits::OBJ_DISPLAY_ENABLE); //Can be toggled mid scanline but we will test it here for now
         sst.obj_size = lcd->get_lcd_control_attr(lcd_control_bits::OBJ_SIZE);
         
-        sst.overlap_sprite_indices.clear();
-        for (int i = 0; i < 40; i++)
+        // Candidates for this line come from its bucket in OAM order, the first 10 that fit the height are kept
+        sst.line_sprite_count = 0;
+        uint64_t candidates = sst.ly < PpuConstants::VISIBLE_SCANLINES ? sprite_buckets[sst.ly] : 0;
+        while (candidates && sst.line_sprite_count < 10) //Max 10 sprites per scanline
         {
+            int i = std::countr_zero(candidates);
+            candidates &= candidates - 1;
             int16_t sprite_y = static_cast<int16_t>(oam[i].y_pos) - 16; //Sprite Y position is offset by 16
-            uint8_t sprite_height = sst.obj_size ? 16 : 8;
-            if (sst.ly >= sprite_y && sst.ly < (sprite_y + sprite_height))
+            if (!sst.obj_size && sst.ly >= sprite_y + 8)
+                continue; // Bottom half of an 8x16 sprite
+            // Insertion sort by X coordinate (ascending); candidates arrive in OAM order, so equal X keeps the lower OAM index first
+            int slot = sst.line_sprite_count++;
+            while (slot > 0 && oam[sst.line_sprites[slot - 1]].x_pos > oam[i].x_pos)
             {
-                sst.overlap_sprite_indices.push_back(i);
-                if (sst.overlap_sprite_indices.size() >= 10) //Max 10 sprites per scanline
-                    break;
+                sst.line_sprites[slot] = sst.line_sprites[slot - 1];
+                slot--;
             }
+            sst.line_sprites[slot] = static_cast<uint8_t>(i);
         }
 
-        // Sort sprites by X coordinate (ascending), with OAM index as tiebreaker
-        // Lower X coordinate = higher priority, lower OAM index = higher priority for same X
-        std::sort(sst.overlap_sprite_indices.begin(), sst.overlap_sprite_indices.end(), [this](int a, int b) {
-        uint8_t x_a = oam[a].x_pos;
-        uint8_t x_b = oam[b].x_pos;
-        if (x_a != x_b)
-            return x_a < x_b; // Lower X coordinate first
-        return a < b; // Lower OAM index first for same X
-        });
-
         lcd->set_mode(LCD_Modes::PIXEL_TRANSFER);
+        bus->map_vram_pages(); // VRAM is locked from here until HBlank
     }
 }
 
@@ -100,36 +159,43 @@ void Ppu::handle_pixel_transfer() // We handle background drawing and window dra
 {
     if (dot >= PpuConstants::OAM_SEARCH_DOTS + PpuConstants::PIXEL_TRANSFER_DOTS)
     {
+        if (!lcd->regs.lcd_control.lcd_enable) // LCD off: nothing is drawn
+        {
+            lcd->set_mode(LCD_Modes::HBLANK);
+            return;
+        }
         // Hoist per-scanline constants
         sctx = 
         {
             .vram_base_ptr = reinterpret_cast<uint8_t*>(vram_back),
-            .bg_map_base_ptr = nullptr,
-            .win_map_base_ptr = nullptr,
+            .bg_map = static_cast<uint8_t>(lcd->get_lcd_control_attr(lcd_control_bits::BG_TILE_MAP_DISPLAY_SELECT) ? 1 : 0),
+            .win_map = static_cast<uint8_t>(lcd->get_lcd_control_attr(lcd_control_bits::WINDOW_TILE_MAP_DISPLAY_SELECT) ? 1 : 0),
             .tile_data_base_addr = static_cast<uint16_t>(lcd->get_lcd_control_attr(lcd_control_bits::BG_WINDOW_TILE_DATA_SELECT) ? 0x8000 : 0x9000),
             .window_enabled = lcd->get_lcd_control_attr(lcd_control_bits::WINDOW_DISPLAY_ENABLE) && (sst.wy <= sst.ly),
             .wx_start = static_cast<int>(sst.wx) - 7
         };
-        sctx.bg_map_base_ptr  = sctx.vram_base_ptr + (lcd->get_lcd_control_attr(lcd_control_bits::BG_TILE_MAP_DISPLAY_SELECT)     ? 0x1C00 : 0x1800);
-        sctx.win_map_base_ptr = sctx.vram_base_ptr + (lcd->get_lcd_control_attr(lcd_control_bits::WINDOW_TILE_MAP_DISPLAY_SELECT) ? 0x1C00 : 0x1800);
 
-        bool window_rendered_this_line = false;
         lcd->set_mode(LCD_Modes::HBLANK);
+        bus->map_vram_pages();
 
-        for (int i = 0; i < 160; i++)
+        // Background up to where the window starts, the window from there to the right edge
+        int window_start = sctx.window_enabled ? std::clamp(sctx.wx_start, 0, PpuConstants::SCREEN_WIDTH) : PpuConstants::SCREEN_WIDTH;
+        bool window_rendered_this_line = window_start < PpuConstants::SCREEN_WIDTH;
+        if (sst.background_enabled)
         {
-            if (sctx.window_enabled && i >= sctx.wx_start)
-            {
-                set_pixel(i, sst.window_line_counter, -(sst.wx - 7), 0, true, sctx); // Render window pixel
-                window_rendered_this_line = true;
-            }
-            else
-            {
-                set_pixel(i, sst.ly, sst.scx, sst.scy, false, sctx); // Render background pixel
-            }
+            render_tile_span(0, window_start, sst.scx, static_cast<uint8_t>(sst.ly + sst.scy), sctx.bg_map, sctx);
+            if (window_rendered_this_line)
+                render_tile_span(window_start, PpuConstants::SCREEN_WIDTH, static_cast<uint8_t>(window_start - sctx.wx_start), sst.window_line_counter, sctx.win_map, sctx);
+        }
+        else
+        {
+            // LCDC bit 0 off: background is color 0, the window is left as it was
+            int scanline_offset = sst.ly * PpuConstants::SCREEN_WIDTH;
+            std::memset(bgwin_color_ids + scanline_offset, 0, window_start);
+            std::memset(screen_back + scanline_offset, lcd->regs.bg_palette.get_color(0), window_start);
         }
         if (sst.objs_enabled)
-            oam_render_scanline(sctx); // Render sprites on top of background/window
+            oam_render_scanline(); // Render sprites on top of background/window
         if (window_rendered_this_line)
         {
             sst.window_line_counter++;
@@ -147,12 +213,15 @@ void Ppu::handle_hblank()
         {
             lcd->set_mode(LCD_Modes::VBLANK);
             cpu->request_interrupt(Interrupts::InterruptMask::IT_VBlank);
+            frame_count++;
+            if (lcd->regs.lcd_control.lcd_enable) // With the LCD off nothing was drawn, keep showing the last frame
+                publish_frame();
         }
         else
         {
             lcd->set_mode(LCD_Modes::OAM_SEARCH);
         }
-        sst.overlap_sprite_indices.clear(); //Clear sprite indices for next scanline
+        sst.line_sprite_count = 0; //Clear sprite indices for next scanline
     }
 }
 
@@ -173,49 +242,86 @@ void Ppu::handle_vblank()
 }
 
 
-void Ppu::set_pixel(int x, int y, int offx, int offy, bool is_window, const scanline_context& ctx) //When it is a window, offx is -(wx - 7), offy is 0 due to internal line counter
+const decoded_tile& Ppu::get_decoded_tile(int tile)
+{
+    decoded_tile& decoded = tile_cache[tile];
+    if (decoded.generation != tile_generation[tile])
+    {
+        decode_tile_rows(reinterpret_cast<const uint8_t*>(vram_back) + tile * 16, 8, decoded.ids);
+        for (int i = 0; i < 64; i++)
+            decoded.x_flipped[i] = decoded.ids[i ^ 7];
+        decoded.generation = tile_generation[tile];
+    }
+    return decoded;
+}
+
+void Ppu::invalidate_vram(uint16_t address, uint32_t count)
+{
+    vram_generation++;
+    int offset = address - 0x8000;
+    if (offset >= PpuConstants::TILE_DATA_SIZE)
+        return;
+    int last = std::min<int>((offset + count - 1) >> 4, PpuConstants::TILE_COUNT - 1);
+    for (int tile = offset >> 4; tile <= last; tile++)
+        tile_generation[tile]++;
+}
+
+const uint8_t* Ppu::get_bg_bitmap_row(int map, bool unsigned_tiles, uint8_t y)
 {
-    uint8_t ly = sst.ly;     // LY is always used for setting the pixel y position so don't use the y parameter
-    int scanline_offset = ly * PpuConstants::SCREEN_WIDTH; // Cache this calculation
-    if (!sst.background_enabled)
+    bg_bitmap& bitmap = bg_bitmaps[map * 2 + unsigned_tiles];
+    int cell_row = y >> 3;
+    if (bitmap.row_generation[cell_row] != vram_generation)
     {
-        if (!is_window)
+        // Something in VRAM changed since this row was last used: redraw the cells whose map entry or tile did
+        const uint8_t* map_row = reinterpret_cast<const uint8_t*>(vram_back) + 0x1800 + map * 0x400 + cell_row * PpuConstants::TILE_MAP_WIDTH;
+        for (int col = 0; col < PpuConstants::TILE_MAP_WIDTH; col++)
         {
-            bgwin_color_ids[scanline_offset + x] = 0; // Update the bg color ID tracking array for priority handling
-            screen_back[scanline_offset + x] = lcd->regs.bg_palette.get_color(0); // Write the color ID to the screen buffer
+            int cell = cell_row * PpuConstants::TILE_MAP_WIDTH + col;
+            uint8_t tile_index = map_row[col];
+            int tile = unsigned_tiles ? tile_index : 256 + static_cast<int8_t>(tile_index); // 0x9000 addressing takes a signed index
+            if (bitmap.cell_tile[cell] == tile && bitmap.cell_generation[cell] == tile_generation[tile])
+                continue;
+            const decoded_tile& decoded = get_decoded_tile(tile);
+            uint8_t* cell_pixels = bitmap.pixels + cell_row * 8 * 256 + col * 8;
+            for (int line = 0; line < 8; line++)
+                std::memcpy(cell_pixels + line * 256, decoded.ids + line * 8, 8);
+            bitmap.cell_tile[cell] = static_cast<uint16_t>(tile);
+            bitmap.cell_generation[cell] = tile_generation[tile];
         }
-        return;
+        bitmap.row_generation[cell_row] = vram_generation;
     }
-    uint8_t* tile_map_base_ptr = is_window ? ctx.win_map_base_ptr : ctx.bg_map_base_ptr; // Select the precomputed tile map
-    uint16_t tile_data_base_addr = ctx.tile_data_base_addr;
-    uint8_t tile_row = ((y + offy) & 255) >> 3; 
-    uint8_t tile_col = ((x + offx) & 255) >> 3; 
-    uint8_t tile_index = tile_map_base_ptr[tile_row * PpuConstants::TILE_MAP_WIDTH + tile_col]; // Get the tile index from the tile map
-    uint16_t tile_data_addr;
-    if (tile_data_base_addr == 0x8000)
-        tile_data_addr = 0x8000 + (tile_index * 16); // Each tile is 16 bytes, tile indices always range from 0-255
-    else
-        tile_data_addr = 0x9000 + (static_cast<int8_t>(tile_index) * 16); // Signed index for 9000 addressing mode, casting uint8_t might be risky but worth a shot
-    uint8_t line_within_tile = (y + offy) % 8; // Which line within the tile we are drawing (0-7), scy is needed here otherwise text will appear garbled 
-    uint8_t pixel_within_tile = (x + offx) % 8; // Which pixel within the tile we are drawing (0-7), since SCX and SCY can be between 0 and 255 (not 32) the gameboy can render tiles partially (like half a tile on the left side of the screen)
-    uint8_t byte1 = ctx.vram_base_ptr[tile_data_addr - 0x8000 + (line_within_tile * 2)];     // Each line is 2 bytes so multiply by 2
-    uint8_t byte2 = ctx.vram_base_ptr[tile_data_addr - 0x8000 + (line_within_tile * 2) + 1]; // Second byte
-    uint8_t bit_index = 7 - pixel_within_tile; // Bits are ordered from MSB to LSB, so we need to invert the pixel index
-    uint8_t color_bit0 = (byte1 >> bit_index) & 0x01; // Get the bit for color 0
-    uint8_t color_bit1 = (byte2 >> bit_index) & 0x01; // Get the bit for color 1
-    uint8_t color_id = (color_bit1 << 1) | color_bit0;
-    bgwin_color_ids[scanline_offset + x] = color_id; // Update the bg color ID tracking array for priority handling
-    screen_back[scanline_offset + x] = lcd->regs.bg_palette.get_color(color_id); // Write the color ID to the screen buffer
+    return bitmap.pixels + y * 256;
 }
 
-void Ppu::oam_render_scanline(const scanline_context& ctx)
+void Ppu::render_tile_span(int x_begin, int x_end, uint8_t map_x, uint8_t map_y, int map, const scanline_context& ctx)
+{
+    // Screen pixels [x_begin, x_end) are a wrapped copy of one line of the composed map, starting at map_x
+    if (x_begin >= x_end)
+        return;
+    int scanline_offset = sst.ly * PpuConstants::SCREEN_WIDTH;
+    uint8_t* screen_row = screen_back + scanline_offset;
+    uint8_t* ids_row = bgwin_color_ids + scanline_offset;
+    const uint8_t* map_line = get_bg_bitmap_row(map, ctx.tile_data_base_addr == 0x8000, map_y);
+    int length = x_end - x_begin;
+    int before_wrap = std::min(length, 256 - map_x);
+    std::memcpy(ids_row + x_begin, map_line + map_x, before_wrap);
+    std::memcpy(ids_row + x_begin + before_wrap, map_line, length - before_wrap);
+
+    const uint8_t palette = lcd->regs.bg_palette;
+    const uint8_t shades[4] = { static_cast<uint8_t>(palette & 3), static_cast<uint8_t>((palette >> 2) & 3),
+                                static_cast<uint8_t>((palette >> 4) & 3), static_cast<uint8_t>(palette >> 6) };
+    for (int x = x_begin; x < x_end; x++)
+        screen_row[x] = shades[ids_row[x]];
+}
+
+void Ppu::oam_render_scanline()
 {
     int scanline_offset = sst.ly * PpuConstants::SCREEN_WIDTH; // Cache scanline offset
     bool sprite_drawn[PpuConstants::SCREEN_WIDTH] = {}; // Track which X positions already have a sprite pixel
-    
-    for (int sprite_idx : sst.overlap_sprite_indices)
+
+    for (int i = 0; i < sst.line_sprite_count; i++)
     {
-        const oam_entry& sprite = oam[sprite_idx];
+        const oam_entry& sprite = oam[sst.line_sprites[i]];
         int16_t sprite_y = static_cast<int16_t>(sprite.y_pos) - 16; // Sprite Y position is offset by 16
         int16_t sprite_x = static_cast<int16_t>(sprite.x_pos) - 8;  // Sprite X position is offset by 8
         uint8_t sprite_height = 8 + (sst.obj_size << 3); // 2**3 = 8, 
@@ -229,31 +335,34 @@ void Ppu::oam_render_scanline(const scanline_context& ctx)
             if (line_within_sprite >= 8)
                 tile_index += 1; // Bottom half uses the following tile in the pair
         }
-        uint8_t* tile_base_ptr = ctx.vram_base_ptr + tile_index * 16; // Pointer to the start of the tile data for this sprite
-        uint8_t byte1 = tile_base_ptr[(line_within_sprite & 7) * 2];     // Each line is 2 bytes so multiply by 2
-        uint8_t byte2 = tile_base_ptr[(line_within_sprite & 7) * 2 + 1]; // Second byte
-        for (int bit = 7; bit >= 0; bit--)
+        const decoded_tile& tile = get_decoded_tile(tile_index); // Sprites always use 0x8000 addressing
+        const uint8_t* sprite_ids = (sprite.attr.x_flip ? tile.x_flipped : tile.ids) + (line_within_sprite & 7) * 8;
+        pallette_data& obj_palette = sprite.attr.palette_number ? lcd->regs.obj_palette_1 : lcd->regs.obj_palette_0;
+        for (int pixel = 0; pixel < 8; pixel++)
         {
-            int screen_x_offset = bit ^ (sprite.attr.x_flip ? 0 : 7);
-            int screen_x = sprite_x + screen_x_offset; // Calculate screen X position
+            int screen_x = sprite_x + pixel; // Calculate screen X position
             if (screen_x < 0 || screen_x >= PpuConstants::SCREEN_WIDTH)
                 continue; // Skip pixels outside the screen
             if (sprite_drawn[screen_x])
                 continue; // Sprite priority: earlier sprite in OAM wins for same X coordinate
-            uint8_t color_bit0 = (byte1 >> bit) & 0x01; // Get the bit for color 0
-            uint8_t color_bit1 = (byte2 >> bit) & 0x01; // Get the bit for color 1
-            uint8_t color_id = (color_bit1 << 1) | color_bit0;
+            uint8_t color_id = sprite_ids[pixel];
             if (color_id == 0)
                 continue; // Color ID 0 is transparent for sprites
             if (sprite.attr.priority && bgwin_color_ids[scanline_offset + screen_x] != 0) 
                 continue; // Skip drawing this pixel due to priority, if priority bit is set, color ID 1-3 of BG/WIN have priority over sprite
-            pallette_data& obj_palette = sprite.attr.palette_number ? lcd->regs.obj_palette_1 : lcd->regs.obj_palette_0;
             screen_back[scanline_offset + screen_x] = obj_palette.get_color(color_id); // Write the color ID to the screen buffer
             sprite_drawn[screen_x] = true; // Mark this X position as having a sprite pixel
         }
     }
 }
 
+uint8_t* Ppu::get_vram_pages()
+{
+    if (lcd && lcd->regs.lcd_control.lcd_enable && lcd->regs.lcd_status.mode_flag == static_cast<uint8_t>(LCD_Modes::PIXEL_TRANSFER))
+        return nullptr;
+    return reinterpret_cast<uint8_t*>(vram_back);
+}
+
 uint8_t Ppu::vram_read(uint16_t address) const
 {
     // If LCD if off, vram is always accessible
@@ -286,6 +395,9 @@ void Ppu::vram_write(uint16_t address, uint8_t value)
     // VRAM range: 0x8000-0x9FFF (8KB)
     uint16_t offset = address - 0x8000;
     reinterpret_cast<uint8_t*>(vram_back)[offset] = value;
+    vram_generation++;
+    if (offset < PpuConstants::TILE_DATA_SIZE)
+        tile_generation[offset >> 4]++;
 }
 
 uint8_t Ppu::oam_read(uint16_t address) const
@@ -301,5 +413,17 @@ void Ppu::oam_write(uint16_t address, uint8_t value)
     // OAM range: 0xFE00-0xFE9F (160 bytes)
     uint8_t offset = address - 0xFE00;
     uint8_t* oam_ptr = reinterpret_cast<uint8_t*>(&oam);
+    if ((offset & 3) == 0 && oam_ptr[offset] != value)
+        move_sprite_bucket(offset >> 2, oam_ptr[offset], value); // Y byte, covers OAM DMA too since it writes through here
     oam_ptr[offset] = value;
+}
+
+void Ppu::move_sprite_bucket(int sprite, uint8_t old_y, uint8_t new_y)
+{
+    // A sprite at Y covers lines Y-16 to Y-1 at 8x16
+    uint64_t bit = uint64_t{1} << sprite;
+    for (int line = std::max(old_y - 16, 0); line < std::min<int>(old_y, PpuConstants::VISIBLE_SCANLINES); line++)
+        sprite_buckets[line] &= ~bit;
+    for (int line = std::max(new_y - 16, 0); line < std::min<int>(new_y, PpuConstants::VISIBLE_SCANLINES); line++)
+        sprite_buckets[line] |= bit;
 }
\ No newline at end of file
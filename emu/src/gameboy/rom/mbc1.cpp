@@ -51,6 +51,29 @@ uint8_t MBC1::cart_read(uint16_t addr)
     // Bank 0 (0x0000-0x3FFF) is always fixed and handled by ROM::cart_read
     return ROM::cart_read(addr);
 }
+
+const uint8_t* MBC1::cart_page(uint8_t page)
+{
+    if (page >= 0x40 && page <= 0x7F)
+    {
+        // Switchable ROM Bank (0x4000-0x7FFF)
+        if (!mbc1_regs.current_rom_bank) {
+            return nullptr;
+        }
+        return mbc1_regs.current_rom_bank + ((page - 0x40) << 8);
+    }
+    return ROM::cart_page(page);
+}
+
+int MBC1::rom_bank(uint16_t addr)
+{
+    if (addr >= 0x4000 && addr <= 0x7FFF)
+    {
+        return mbc1_regs.rom_bank_reg; // Same bank update_banking selected
+    }
+    return ROM::rom_bank(addr);
+}
+
 void MBC1::cart_write(uint16_t addr, uint8_t value)
 {
     if (MemoryMap::is_mbc1_ram_enable_area(addr)) 
@@ -26,6 +26,28 @@ uint8_t ROM::cart_read(uint16_t addr)
     return ctx.rom_data[addr];
 }
 
+const uint8_t* ROM::cart_page(uint8_t page)
+{
+    if (ctx.bootrom_enabled && page == 0)
+    {
+        return ctx.bootrom_data;
+    }
+    uint32_t offset = static_cast<uint32_t>(page) << 8;
+    if (!ctx.rom_data || offset + 0x100 > ctx.rom_size) {
+        return nullptr; // Leave it to cart_read
+    }
+    return ctx.rom_data.get() + offset;
+}
+
+int ROM::rom_bank(uint16_t addr)
+{
+    if (ctx.bootrom_enabled && addr < 0x0100)
+    {
+        return -1;
+    }
+    return addr >> 14;
+}
+
 void ROM::cart_write(uint16_t addr, uint8_t value)
 {
     // Default implementation does nothing, overridden by MBC classes
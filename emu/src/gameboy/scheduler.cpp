@@ -0,0 +1,66 @@
+#include "scheduler.h"
+#include "timer.h"
+#include "ppu.h"
+#include "dma.h"
+#include "serial.h"
+
+Scheduler::Scheduler() : timer(nullptr), ppu(nullptr), dma(nullptr), serial(nullptr), next_deadline(NEVER)
+{
+    deadlines.fill(NEVER);
+}
+
+void Scheduler::recompute_next()
+{
+    next_deadline = NEVER;
+    for (uint64_t deadline : deadlines) {
+        if (deadline < next_deadline)
+            next_deadline = deadline;
+    }
+}
+
+void Scheduler::schedule(SchedulerEvent event, uint64_t when)
+{
+    deadlines[static_cast<std::size_t>(event)] = when;
+    recompute_next();
+}
+
+void Scheduler::cancel(SchedulerEvent event)
+{
+    deadlines[static_cast<std::size_t>(event)] = NEVER;
+    recompute_next();
+}
+
+void Scheduler::dispatch()
+{
+    // Every due component catches up to the current time, handlers reschedule themselves
+    // Fixed slot order keeps the old tick order (timer and PPU per T-cycle, then DMA per M-cycle)
+    while (now >= next_deadline) {
+        for (std::size_t i = 0; i < deadlines.size(); i++) {
+            if (now >= deadlines[i]) {
+                deadlines[i] = NEVER;
+                fire(static_cast<SchedulerEvent>(i));
+            }
+        }
+        recompute_next();
+    }
+}
+
+void Scheduler::fire(SchedulerEvent event)
+{
+    switch (event) {
+        case SchedulerEvent::TIMER:
+            timer->sync();
+            break;
+        case SchedulerEvent::PPU:
+            ppu->sync();
+            break;
+        case SchedulerEvent::DMA:
+            dma->sync();
+            break;
+        case SchedulerEvent::SERIAL:
+            serial->sync();
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,94 @@
+#include "serial.h"
+#include "bus.h"
+#include "scheduler.h"
+#include "interrupts.h"
+#include <iostream>
+
+StdoutSerialSink::~StdoutSerialSink()
+{
+    if (!line.empty())
+        std::cout << line << std::flush;
+}
+
+uint8_t StdoutSerialSink::exchange(uint8_t out)
+{
+    line += static_cast<char>(out);
+    if (out == '\n' || line.length() >= 128) {
+        std::cout << line;
+        line.clear();
+    }
+    return 0xFF; // Nothing on the other end
+}
+
+uint8_t FileSerialSink::exchange(uint8_t out)
+{
+    file.put(static_cast<char>(out));
+    return 0xFF;
+}
+
+uint8_t PeerSerialSink::exchange(uint8_t out)
+{
+    return peer.receive(out);
+}
+
+Serial::Serial() : bus(nullptr), scheduler(nullptr), sink(std::make_unique<StdoutSerialSink>()), sb(0), sc(0),
+                   peer_in(0xFF), peer_clocked(false)
+{
+}
+
+void Serial::set_cmp(Bus* bus_ptr, Scheduler* scheduler_ptr)
+{
+    bus = bus_ptr;
+    scheduler = scheduler_ptr;
+    bus->map_io<&Serial::read, &Serial::write>(MemoryMap::SERIAL_DATA, MemoryMap::SERIAL_CONTROL, this);
+}
+
+uint8_t Serial::read(uint16_t address)
+{
+    if (address == MemoryMap::SERIAL_DATA)
+        return sb;
+    return sc | 0x7E; // Bits 1-6 are unused and read as 1
+}
+
+void Serial::write(uint16_t address, uint8_t value)
+{
+    if (address == MemoryMap::SERIAL_DATA) {
+        sb = value;
+        return;
+    }
+    sc = value & 0x81;
+    peer_clocked = false;
+    if ((sc & 0x81) == 0x81)
+        scheduler->schedule(SchedulerEvent::SERIAL, scheduler->now + TRANSFER_CYCLES);
+    else
+        scheduler->cancel(SchedulerEvent::SERIAL); // Stopped, or waiting on a peer's clock
+}
+
+void Serial::sync()
+{
+    if (peer_clocked) {
+        peer_clocked = false;
+        complete(peer_in);
+        return;
+    }
+    complete(sink ? sink->exchange(sb) : 0xFF);
+}
+
+uint8_t Serial::receive(uint8_t in)
+{
+    if ((sc & 0x81) != 0x80 || peer_clocked)
+        return 0xFF; // Not armed on the external clock, the line stays high
+    // IF is only raised from scheduled events (HALT fast-forward, idle skipping and bulk loops rely on it):
+    // complete at this instance's current time, before its next instruction
+    peer_in = in;
+    peer_clocked = true;
+    scheduler->schedule(SchedulerEvent::SERIAL, scheduler->now);
+    return sb;
+}
+
+void Serial::complete(uint8_t in)
+{
+    sb = in;
+    sc &= 0x7F;
+    bus->if_register |= static_cast<uint8_t>(Interrupts::InterruptMask::IT_Serial);
+}
@@ -0,0 +1,212 @@
+#include "tile_decode.h"
+#include <atomic>
+#include <cstring>
+
+// SSE2 is part of x86-64, AVX2 is compiled per function and only picked after a CPUID check
+#if defined(__x86_64__) || defined(_M_X64)
+#define TILE_DECODE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(TILE_DECODE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define TILE_DECODE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    using decode_fn = void (*)(const uint8_t*, int, uint8_t*, uint8_t*, uint8_t);
+
+    void decode_scalar(const uint8_t* planes, int rows, uint8_t* ids, uint8_t* shades, uint8_t palette)
+    {
+        for (int row = 0; row < rows; row++, planes += 2)
+        {
+            uint8_t low = planes[0];
+            uint8_t high = planes[1];
+            for (int pixel = 0; pixel < 8; pixel++)
+            {
+                int bit = 7 - pixel;
+                uint8_t color_id = ((low >> bit) & 1) | (((high >> bit) & 1) << 1);
+                ids[pixel] = color_id;
+                if (shades)
+                    shades[pixel] = (palette >> (color_id << 1)) & 0x03;
+            }
+            ids += 8;
+            if (shades)
+                shades += 8;
+        }
+    }
+
+#ifdef TILE_DECODE_SSE2
+    // Two rows per iteration: each bitplane byte is spread over 8 lanes, lane i tests bit 7 - i
+    void decode_sse2(const uint8_t* planes, int rows, uint8_t* ids, uint8_t* shades, uint8_t palette)
+    {
+        const __m128i bit_mask = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i two = _mm_set1_epi8(2);
+        const __m128i three = _mm_set1_epi8(3);
+        const __m128i shade_1 = _mm_set1_epi8(static_cast<char>((palette >> 2) & 3));
+        const __m128i shade_2 = _mm_set1_epi8(static_cast<char>((palette >> 4) & 3));
+        const __m128i shade_3 = _mm_set1_epi8(static_cast<char>((palette >> 6) & 3));
+        const __m128i shade_0 = _mm_set1_epi8(static_cast<char>(palette & 3));
+        int row = 0;
+        for (; row + 2 <= rows; row += 2, planes += 4, ids += 16)
+        {
+            uint32_t pair;
+            std::memcpy(&pair, planes, sizeof(pair));
+            __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(pair));            // l0 h0 l1 h1
+            bytes = _mm_unpacklo_epi8(bytes, bytes);                              // l0 l0 h0 h0 l1 l1 h1 h1
+            bytes = _mm_unpacklo_epi16(bytes, bytes);                             // l0 x4, h0 x4, l1 x4, h1 x4
+            __m128i low = _mm_shuffle_epi32(bytes, _MM_SHUFFLE(2, 2, 0, 0));     // l0 x8, l1 x8
+            __m128i high = _mm_shuffle_epi32(bytes, _MM_SHUFFLE(3, 3, 1, 1));    // h0 x8, h1 x8
+            low = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(low, bit_mask), bit_mask), one);
+            high = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(high, bit_mask), bit_mask), two);
+            __m128i color_ids = _mm_or_si128(low, high);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(ids), color_ids);
+            if (shades)
+            {
+                // No byte shuffle in SSE2, select each shade by comparing against the four IDs
+                __m128i result = _mm_and_si128(_mm_cmpeq_epi8(color_ids, _mm_setzero_si128()), shade_0);
+                result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi8(color_ids, one), shade_1));
+                result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi8(color_ids, two), shade_2));
+                result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi8(color_ids, three), shade_3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(shades), result);
+                shades += 16;
+            }
+        }
+        if (row < rows)
+            decode_scalar(planes, rows - row, ids, shades, palette);
+    }
+#endif
+
+#ifdef TILE_DECODE_AVX2
+    // Four rows per iteration: the 8 plane bytes go to both 128-bit lanes and a byte shuffle spreads them,
+    // a second shuffle through a 4-entry table applies the palette
+    __attribute__((target("avx2")))
+    void decode_avx2(const uint8_t* planes, int rows, uint8_t* ids, uint8_t* shades, uint8_t palette)
+    {
+        const __m256i bit_mask = _mm256_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m256i low_index = _mm256_set_epi8(6, 6, 6, 6, 6, 6, 6, 6, 4, 4, 4, 4, 4, 4, 4, 4,
+                                                  2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i high_index = _mm256_set_epi8(7, 7, 7, 7, 7, 7, 7, 7, 5, 5, 5, 5, 5, 5, 5, 5,
+                                                   3, 3, 3, 3, 3, 3, 3, 3, 1, 1, 1, 1, 1, 1, 1, 1);
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i two = _mm256_set1_epi8(2);
+        const __m128i shade_table = _mm_setr_epi8(static_cast<char>(palette & 3), static_cast<char>((palette >> 2) & 3),
+                                                  static_cast<char>((palette >> 4) & 3), static_cast<char>((palette >> 6) & 3),
+                                                  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i shade_lut = _mm256_broadcastsi128_si256(shade_table);
+        int row = 0;
+        for (; row + 4 <= rows; row += 4, planes += 8, ids += 32)
+        {
+            __m256i bytes = _mm256_broadcastq_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(planes)));
+            __m256i low = _mm256_shuffle_epi8(bytes, low_index);
+            __m256i high = _mm256_shuffle_epi8(bytes, high_index);
+            low = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(low, bit_mask), bit_mask), one);
+            high = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(high, bit_mask), bit_mask), two);
+            __m256i color_ids = _mm256_or_si256(low, high);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(ids), color_ids);
+            if (shades)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(shades), _mm256_shuffle_epi8(shade_lut, color_ids));
+                shades += 32;
+            }
+        }
+        if (row < rows)
+        {
+            _mm256_zeroupper(); // The SSE2 code is not VEX encoded, dirty upper halves would stall it
+            decode_sse2(planes, rows - row, ids, shades, palette);
+        }
+    }
+#endif
+
+    decode_fn kernel_function(TileDecodeKernel kernel)
+    {
+        switch (kernel)
+        {
+#ifdef TILE_DECODE_AVX2
+            case TileDecodeKernel::AVX2: return decode_avx2;
+#endif
+#ifdef TILE_DECODE_SSE2
+            case TileDecodeKernel::SSE2: return decode_sse2;
+#endif
+            default: return decode_scalar;
+        }
+    }
+
+    TileDecodeKernel best_kernel()
+    {
+        if (tile_decode_kernel_supported(TileDecodeKernel::AVX2))
+            return TileDecodeKernel::AVX2;
+        if (tile_decode_kernel_supported(TileDecodeKernel::SSE2))
+            return TileDecodeKernel::SSE2;
+        return TileDecodeKernel::SCALAR;
+    }
+
+    struct active_kernel
+    {
+        std::atomic<TileDecodeKernel> kind;
+        std::atomic<decode_fn> function;
+    };
+
+    // Picked on first use, function-local so it is ready even when called during static initialization
+    active_kernel& active()
+    {
+        static active_kernel kernel = []() {
+            TileDecodeKernel best = best_kernel();
+            return active_kernel{ best, kernel_function(best) };
+        }();
+        return kernel;
+    }
+}
+
+void decode_tile_rows(const uint8_t* planes, int rows, uint8_t* ids, uint8_t* shades, uint8_t palette)
+{
+    active().function.load(std::memory_order_relaxed)(planes, rows, ids, shades, palette);
+}
+
+TileDecodeKernel get_tile_decode_kernel()
+{
+    return active().kind.load(std::memory_order_relaxed);
+}
+
+bool set_tile_decode_kernel(TileDecodeKernel kernel)
+{
+    if (!tile_decode_kernel_supported(kernel))
+        return false;
+    active().kind.store(kernel, std::memory_order_relaxed);
+    active().function.store(kernel_function(kernel), std::memory_order_relaxed);
+    return true;
+}
+
+bool tile_decode_kernel_supported(TileDecodeKernel kernel)
+{
+    switch (kernel)
+    {
+        case TileDecodeKernel::SCALAR:
+            return true;
+        case TileDecodeKernel::SSE2:
+#ifdef TILE_DECODE_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case TileDecodeKernel::AVX2:
+#ifdef TILE_DECODE_AVX2
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+const char* tile_decode_kernel_name(TileDecodeKernel kernel)
+{
+    switch (kernel)
+    {
+        case TileDecodeKernel::SCALAR: return "scalar";
+        case TileDecodeKernel::SSE2: return "SSE2";
+        case TileDecodeKernel::AVX2: return "AVX2";
+    }
+    return "unknown";
+}
@@ -1,43 +1,44 @@
 #include "timer.h"
+#include "scheduler.h"
 
-Timer::Timer() : div(0xAC00), tima(0), tma(0), tac(0), bus(nullptr)
+// The divider powers up at 0xAC00 on a DMG, so its epoch lies 0xAC00 cycles before the clock starts
+// (unsigned wrap-around keeps now - div_epoch correct)
+Timer::Timer() : div_epoch(0 - static_cast<uint64_t>(0xAC00)), tima(0), tma(0), tac(0), bus(nullptr), scheduler(nullptr), last_sync(0)
 {
 }
 
-void Timer::falling_edge_check()
+uint8_t Timer::edge_shift() const
 {
-
-    // How I believe this is intended to work: the timer is effectively checking for an overflow from bit n to bit n+1
-    // Ex: old_div = 0b1111 or 15, div = 0b10000 or 16: there is a carry from bit 3 to bit 4, signifying a virtual overflow (if the available bits would be [n:0]) meaning 16 t states have passed
-    // Div register bug, whenever the div register is reset, it may cause a falling edge if the timer is enabled and the selected bit is high in the old div value
-    uint16_t bit_mask = 0;
+    // TIMA increments on a falling edge of one DIV bit, which happens once every 2^(bit + 1) T-cycles
     switch (tac & 0b11) {
-        case 0: bit_mask = 1 << 9; break;  // 4096 Hz
-        case 1: bit_mask = 1 << 3; break;  // 262144 Hz
-        case 2: bit_mask = 1 << 5; break;  // 65536 Hz
-        case 3: bit_mask = 1 << 7; break;  // 16384 Hz
+        case 0: return 10; // bit 9, 4096 Hz
+        case 1: return 4;  // bit 3, 262144 Hz
+        case 2: return 6;  // bit 5, 65536 Hz
+        default: return 8; // bit 7, 16384 Hz
     }
-    
-    bool falling_edge = (old_div & bit_mask) && !(div & bit_mask);
-    bool timer_enabled = (tac & 0b100);
-    
-    if (falling_edge && timer_enabled) {
-        uint8_t prev = tima;
-        tima++;
-        if (prev == 0xFF) {
-            tima = tma;
-            if (bus) {
-                bus->if_register |= static_cast<uint8_t>(Interrupts::InterruptMask::IT_Timer);
-            }
-        }
+}
+
+void Timer::increment_tima(uint64_t edges)
+{
+    uint64_t to_overflow = 0x100 - tima;
+    if (edges < to_overflow) {
+        tima += static_cast<uint8_t>(edges);
+        return;
+    }
+    // Overflow reloads TMA, every further 0x100 - TMA edges would overflow again but the flag is already set
+    edges -= to_overflow;
+    tima = tma + static_cast<uint8_t>(edges % (0x100 - tma));
+    if (bus) {
+        bus->if_register |= static_cast<uint8_t>(Interrupts::InterruptMask::IT_Timer);
     }
 }
 
-uint8_t Timer::read(uint16_t address) const
+uint8_t Timer::read(uint16_t address)
 {
+    sync();
     switch (address) {
         case 0xFF04: // DIV
-            return static_cast<uint8_t>(div >> 8);
+            return static_cast<uint8_t>((last_sync - div_epoch) >> 8);
         case 0xFF05: // TIMA
             return tima;
         case 0xFF06: // TMA
@@ -51,12 +52,19 @@ uint8_t Timer::read(uint16_t address) const
 
 void Timer::write(uint16_t address, uint8_t value)
 {
+    sync();
     switch (address) {
         case 0xFF04: // DIV reset
-            old_div = div;
-            div = 0;
-            falling_edge_check();
+        {
+            // Div register bug: resetting DIV while the selected bit is high is itself a falling edge
+            uint16_t div = static_cast<uint16_t>(last_sync - div_epoch);
+            uint16_t bit_mask = static_cast<uint16_t>(1 << (edge_shift() - 1));
+            if ((tac & 0b100) && (div & bit_mask)) {
+                increment_tima(1);
+            }
+            div_epoch = last_sync;
             break;
+        }
         case 0xFF05: // TIMA
             tima = value;
             break;
@@ -67,11 +75,33 @@ void Timer::write(uint16_t address, uint8_t value)
             tac = value & 0b111; // Only lower 3 bits are used
             break;
         }
+    schedule_overflow();
 }
 
-void Timer::tick()
+void Timer::sync()
 {
-    old_div = div;
-    div++;
-    falling_edge_check();
+    uint64_t now = scheduler->now;
+    if (tac & 0b100) {
+        // Falling edges in (last_sync, now] is the difference in how many whole periods the divider has completed
+        uint8_t shift = edge_shift();
+        uint64_t edges = ((now - div_epoch) >> shift) - ((last_sync - div_epoch) >> shift);
+        if (edges) {
+            increment_tima(edges);
+        }
+    }
+    last_sync = now;
+    schedule_overflow();
+}
+
+void Timer::schedule_overflow()
+{
+    // Only a TIMA overflow is visible without a register access, so that is the only event we need
+    if (!(tac & 0b100)) {
+        scheduler->cancel(SchedulerEvent::TIMER);
+        return;
+    }
+    uint64_t period = 1ull << edge_shift();
+    uint64_t first_edge = period - ((last_sync - div_epoch) & (period - 1));
+    uint64_t cycles = first_edge + static_cast<uint64_t>(0xFF - tima) * period;
+    scheduler->schedule(SchedulerEvent::TIMER, last_sync + cycles);
 }
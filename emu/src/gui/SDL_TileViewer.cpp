@@ -1,4 +1,5 @@
 #include "SDL_TileViewer.h"
+#include "tile_decode.h"
 #include <cstring>
 
 SDL_TileViewer::SDL_TileViewer()
@@ -109,18 +110,12 @@ void SDL_TileViewer::render_tile(const uint8_t* vram, int tile_index, int x, int
     
     uint32_t* pixels = static_cast<uint32_t*>(pixels_raw);
     
-    // Decode tile data
-    for (int row = 0; row < TileViewerConstants::TILE_SIZE; row++) 
+    // Decode all 8 rows of the tile at once, then map the color IDs to RGBA
+    uint8_t color_ids[TileViewerConstants::TILE_SIZE * TileViewerConstants::TILE_SIZE];
+    decode_tile_rows(vram + tile_address, TileViewerConstants::TILE_SIZE, color_ids);
+    for (int i = 0; i < TileViewerConstants::TILE_SIZE * TileViewerConstants::TILE_SIZE; i++)
     {
-        uint8_t byte1 = vram[tile_address + (row * 2)]; //Each pixel is represented by 2 bits across 2 bytes
-        uint8_t byte2 = vram[tile_address + (row * 2) + 1];
-        
-        for (int col = 0; col < TileViewerConstants::TILE_SIZE; col++)
-        { // Process each pixel in the row
-            int bit = 7 - col; // The left most bit is for the left pixel, shift it to get the color info
-            uint8_t pixel_value = ((byte1 >> bit) & 1) | (((byte2 >> bit) & 1) << 1); //Each pixel is 2 bits for the color, the bits are swapped when determining the color so OR them to get the final value
-            pixels[row * TileViewerConstants::TILE_SIZE + col] = get_color(pixel_value); 
-        }
+        pixels[i] = get_color(color_ids[i]);
     }
     
     SDL_UnlockTexture(tile_texture.get());
@@ -6,6 +6,7 @@
 #include <QWindow>
 #include <QLayout>
 #include <QTimer>
+#include <QActionGroup>
 #include <iostream>
 #include <fstream>
 #include <SDL3/SDL.h>
@@ -21,6 +22,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->menuFile->addMenu(menuRecent);
     connect(menuRecent, &QMenu::triggered, this, &MainWindow::handleRecentFileAction);
     connect(ui->actionOpen, &QAction::triggered, this, &MainWindow::openFile);
+    createEmulationMenu();
 #ifdef ENABLE_DEBUG_VIEWERS
     connect(this, &MainWindow::requestOpenTileViewer, this, &MainWindow::openTileViewer, Qt::QueuedConnection);
     connect(this, &MainWindow::requestOpenTileMapViewer, this, &MainWindow::openTileMapViewer, Qt::QueuedConnection);
@@ -42,6 +44,7 @@ MainWindow::~MainWindow()
     }
     if (emu) {
         emu->ctx.running = false;
+        emu->get_pacer().stop(); // Wake the thread if it is parked on pause
     }
     if (emuThread.joinable()) {
         emuThread.join();
@@ -108,6 +111,43 @@ void MainWindow::handleRecentFileAction(QAction *action)
     startEmulator(filePath.toStdString(), "roms/dmg_boot.gb");
 }
 
+void MainWindow::createEmulationMenu()
+{
+    QMenu *menuEmulation = menuBar()->addMenu(tr("Emulation"));
+    actionPause = menuEmulation->addAction(tr("Pause"));
+    actionPause->setCheckable(true);
+    actionPause->setShortcut(QKeySequence(Qt::Key_P));
+    connect(actionPause, &QAction::toggled, this, &MainWindow::setPaused);
+
+    QMenu *menuSpeed = menuEmulation->addMenu(tr("Speed"));
+    QActionGroup *speedGroup = new QActionGroup(this);
+    for (double speed : {0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, FramePacer::UNLIMITED}) {
+        QAction *action = menuSpeed->addAction(speed == FramePacer::UNLIMITED ? tr("Unlimited") : QString("%1x").arg(speed));
+        action->setCheckable(true);
+        action->setChecked(speed == emuSpeed);
+        action->setData(speed);
+        speedGroup->addAction(action);
+    }
+    connect(speedGroup, &QActionGroup::triggered, this, &MainWindow::handleSpeedAction);
+}
+
+void MainWindow::handleSpeedAction(QAction *action)
+{
+    emuSpeed = action->data().toDouble();
+    std::lock_guard<std::mutex> lock(emu_ref_mutex);
+    if (emu_ref) {
+        emu_ref->get_pacer().set_speed(emuSpeed);
+    }
+}
+
+void MainWindow::setPaused(bool paused)
+{
+    std::lock_guard<std::mutex> lock(emu_ref_mutex);
+    if (emu_ref) {
+        emu_ref->get_pacer().set_paused(paused);
+    }
+}
+
 void MainWindow::startEmulator(const std::string& romPath, const std::string& bootromPath)
 {
     // Stop previous emulator if running
@@ -118,6 +158,7 @@ void MainWindow::startEmulator(const std::string& romPath, const std::string& bo
     }
     if (old_emu) {
         old_emu->ctx.running = false;
+        old_emu->get_pacer().stop(); // Wake the thread if it is parked on pause
     }
     if (emuThread.joinable()) {
         emuThread.join();
@@ -129,8 +170,9 @@ void MainWindow::startEmulator(const std::string& romPath, const std::string& bo
     
     
     new_emu->ctx.running = true;
-    new_emu->ctx.paused = false;
     new_emu->ctx.ticks = 0;
+    new_emu->get_pacer().set_speed(emuSpeed);
+    new_emu->get_pacer().set_paused(actionPause->isChecked());
     new_emu->get_cpu().cpu_init();
     {
         std::lock_guard<std::mutex> lock(emu_ref_mutex); // protect emu_ref assignment, brackets ensure lock scope is limited
@@ -153,12 +195,13 @@ void MainWindow::startEmulator(const std::string& romPath, const std::string& bo
             std::lock_guard<std::mutex> lock(emu_ref_mutex);
             emu = emu_ref;
         }
+        // One frame at a time, the pacer sleeps off whatever is left of the frame period and parks the thread while paused
+        Ppu& ppu = emu->get_ppu();
         while (emu->ctx.running) {
-            if (emu->ctx.paused) { SDL_Delay(10); continue; }
-            if (!emu->get_cpu().cpu_step()) {
-                SDL_Delay(1);
+            emu->ctx.ticks += emu->get_cpu().cpu_run(ppu.frame_count + 1);
+            if (!emu->get_pacer().wait_frame()) {
+                break;
             }
-            emu->ctx.ticks++;
         }
     });
 }
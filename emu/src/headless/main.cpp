@@ -0,0 +1,175 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "emu.h"
+#include "ppu_constants.h"
+#include "cpu_profile.h"
+
+// Headless runner: executes a ROM for a fixed number of frames as fast as possible (or paced with --speed) and reports throughput.
+// Usage: sdl-gameboy-headless <rom> [--frames N] [--bootrom FILE] [--no-idle-skip] [--profile] [--serial FILE] [--speed X]
+
+namespace {
+    constexpr uint64_t DEFAULT_FRAMES = 600; // 10 seconds of emulated time at ~60 Hz
+
+    void print_usage(const char* prog)
+    {
+        std::cerr << "Usage: " << prog << " <rom> [--frames N] [--bootrom FILE] [--no-idle-skip] [--profile] [--serial FILE] [--speed X]" << std::endl;
+        std::cerr << "  --frames N      Number of frames to emulate (default " << DEFAULT_FRAMES << ")" << std::endl;
+        std::cerr << "  --bootrom FILE  Run the given DMG bootrom instead of starting at 0x0100" << std::endl;
+        std::cerr << "  --no-idle-skip  Run polling loops iteration by iteration instead of fast-forwarding them" << std::endl;
+        std::cerr << "  --profile       Step instruction by instruction and report the most frequent opcode pairs and triples" << std::endl;
+        std::cerr << "  --serial FILE   Write bytes sent over the serial port to FILE instead of stdout" << std::endl;
+        std::cerr << "  --speed X       Pace frames to X times 59.7275 Hz (" << FramePacer::MIN_SPEED << "-" << FramePacer::MAX_SPEED << ", default unpaced)" << std::endl;
+    }
+
+    // FNV-1a hash of the last completed frame, used to check that an optimization did not change the output
+    uint32_t frame_checksum(const uint8_t* buffer)
+    {
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < PpuConstants::SCREEN_BUFFER_SIZE; i++) {
+            hash ^= buffer[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    constexpr std::size_t PROFILE_TOP = 16; // Sequences listed in each --profile table
+
+    // One sequence per line with its share of all instructions, '*' marks those run as a superinstruction
+    void print_sequences(const char* title, const std::vector<OpcodeProfiler::Sequence>& sequences, uint64_t instructions, int length)
+    {
+        std::cout << title << ":" << std::endl;
+        for (const auto& sequence : sequences) {
+            uint8_t opcodes[3];
+            std::cout << "  ";
+            for (int i = 0; i < length; i++) {
+                opcodes[i] = static_cast<uint8_t>(sequence.opcodes >> (8 * (length - 1 - i)));
+                std::cout << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << +opcodes[i] << ' ';
+            }
+            std::cout << std::dec << std::setfill(' ') << (fused_length(opcodes, length) == length ? "* " : "  ")
+                      << std::setw(12) << sequence.count << "  " << 100.0 * sequence.count / instructions << '%' << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string rom_path;
+    std::string bootrom_path;
+    std::string serial_path;
+    uint64_t frames = DEFAULT_FRAMES;
+    bool idle_skip = true;
+    bool profile = false;
+    double speed = FramePacer::UNLIMITED;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--bootrom" && i + 1 < argc) {
+            bootrom_path = argv[++i];
+        } else if (arg == "--no-idle-skip") {
+            idle_skip = false;
+        } else if (arg == "--serial" && i + 1 < argc) {
+            serial_path = argv[++i];
+        } else if (arg == "--speed" && i + 1 < argc) {
+            speed = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (rom_path.empty() && arg[0] != '-') {
+            rom_path = arg;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (rom_path.empty() || frames == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Emu emu(rom_path, bootrom_path);
+    emu.set_component_pointers();
+    emu.get_cpu().cpu_init();
+    if (bootrom_path.empty()) {
+        emu.skip_bootrom();
+    }
+
+    if (!serial_path.empty()) {
+        auto sink = std::make_unique<FileSerialSink>(serial_path);
+        if (!sink->is_open()) {
+            std::cerr << "Could not open " << serial_path << std::endl;
+            return 1;
+        }
+        emu.get_serial().set_sink(std::move(sink));
+    }
+
+    Cpu& cpu = emu.get_cpu();
+    Ppu& ppu = emu.get_ppu();
+    cpu.idle_skip = idle_skip;
+    uint64_t target_frame = ppu.frame_count + frames;
+    uint64_t start_cycles = emu.get_scheduler().now;
+
+    std::unique_ptr<OpcodeProfiler> profiler = profile ? std::make_unique<OpcodeProfiler>() : nullptr; // 512 KiB of pair counters
+    auto start = std::chrono::steady_clock::now();
+    uint64_t instructions = 0;
+    if (profile) {
+        Bus& bus = emu.get_bus();
+        while (ppu.frame_count < target_frame) {
+            if (!cpu.halted)
+                profiler->record(cpu.regs.pc, bus.bus_read(cpu.regs.pc));
+            cpu.cpu_step();
+        }
+        instructions = profiler->instructions;
+    } else if (speed != FramePacer::UNLIMITED) {
+        FramePacer& pacer = emu.get_pacer();
+        pacer.set_speed(speed);
+        while (ppu.frame_count < target_frame) {
+            instructions += cpu.cpu_run(ppu.frame_count + 1);
+            pacer.wait_frame();
+        }
+    } else {
+        instructions = cpu.cpu_run(target_frame);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    ppu.swap_buffers();
+    double elapsed_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    double elapsed_s = elapsed_ns / 1e9;
+    double emulated_cycles = static_cast<double>(emu.get_scheduler().now - start_cycles);
+
+    std::cout << std::dec << std::fixed << std::setprecision(2); // The cartridge header dump leaves cout in hex
+    std::cout << "CPU dispatch     : " << Cpu::dispatch_mode() << std::endl;
+    std::cout << "Frames emulated  : " << frames << std::endl;
+    std::cout << "Host time        : " << elapsed_s * 1000.0 << " ms" << std::endl;
+    std::cout << "Emulated frames/s: " << frames / elapsed_s << std::endl;
+    std::cout << "Host ns/frame    : " << elapsed_ns / frames << std::endl;
+    std::cout << "Instructions     : " << instructions << std::endl;
+    std::cout << "Instructions/s   : " << instructions / elapsed_s << std::endl;
+    std::cout << "Fused dispatches : " << cpu.fused_stats.dispatches << " covering " << cpu.fused_stats.instructions
+              << " instructions (" << (cpu.fused_stats.instructions - cpu.fused_stats.dispatches) / static_cast<double>(frames)
+              << " fewer dispatches/frame)" << std::endl;
+#if GAMEBOY_JIT
+    std::cout << "Native runs      : " << cpu.native_stats.runs << " covering " << cpu.native_stats.instructions
+              << " instructions" << std::endl;
+#endif
+    std::cout << "Idle loop skips  : " << cpu.idle_stats.hits << " (" << 100.0 * cpu.idle_stats.t_cycles / emulated_cycles
+              << "% of emulated time)" << (idle_skip ? "" : ", disabled") << std::endl;
+    std::cout << "Bulk copy loops  : " << cpu.bulk_stats.hits << " (" << cpu.bulk_stats.bytes << " bytes)" << std::endl;
+    std::cout << "Frame checksum   : " << std::hex << std::setw(8) << std::setfill('0')
+              << frame_checksum(ppu.get_screen_buffer()) << std::dec << std::endl;
+    if (profiler) {
+        print_sequences("Top opcode pairs", profiler->top_pairs(PROFILE_TOP), profiler->instructions, 2);
+        print_sequences("Top opcode triples", profiler->top_triples(PROFILE_TOP), profiler->instructions, 3);
+    }
+    return 0;
+}
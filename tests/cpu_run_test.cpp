@@ -0,0 +1,596 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "emu.h"
+
+// Runs small hand-assembled ROMs through Cpu::cpu_run (block cache, idle skip, bulk copies, superinstructions)
+// and through Cpu::cpu_step with HALT spinning one M-cycle at a time, and checks that both end in the same state
+// and show the same last frame. Each case can also check HRAM bytes its interrupt handler records, so a shortcut
+// that moves an interrupt fails even if the state converges later
+
+namespace {
+    constexpr std::size_t ROM_SIZE = 0x8000; // 32 KiB, ROM ONLY
+    constexpr uint64_t FRAMES = 3;
+
+    // What cpu_run's idle loop skipping is expected to do in a case
+    enum class IdleCheck
+    {
+        NONE,    // Not checked
+        SKIPPED, // At least one loop fast-forwarded
+        DISABLED // Cpu::idle_skip off, nothing fast-forwarded
+    };
+
+    // What cpu_run's bulk copy loops are expected to do in a case
+    enum class BulkCheck
+    {
+        NONE,     // Not checked
+        COPIED,   // At least one loop run as a host copy
+        FELL_BACK // Every loop run one instruction at a time
+    };
+
+    struct RomCase
+    {
+        std::string name;
+        std::vector<std::pair<uint16_t, std::vector<uint8_t>>> code; // Bytes placed at each address
+        std::vector<std::pair<uint16_t, uint8_t>> expected;          // HRAM bytes checked after the run
+        IdleCheck idle = IdleCheck::NONE;
+        BulkCheck bulk = BulkCheck::NONE;
+    };
+
+    // Expected HRAM bytes from address on
+    std::vector<std::pair<uint16_t, uint8_t>> hram_bytes(uint16_t address, const std::vector<uint8_t>& bytes)
+    {
+        std::vector<std::pair<uint16_t, uint8_t>> expected;
+        for (uint8_t value : bytes)
+            expected.push_back({address++, value});
+        return expected;
+    }
+
+    std::vector<uint8_t> build_rom(const RomCase& rom_case)
+    {
+        std::vector<uint8_t> rom(ROM_SIZE, 0x00);
+        for (std::size_t i = 0x4000; i < ROM_SIZE; i++)
+            rom[i] = static_cast<uint8_t>(i * 7 + (i >> 8)); // Data for the copy loops to move
+        for (const auto& [address, bytes] : rom_case.code)
+            std::copy(bytes.begin(), bytes.end(), rom.begin() + address);
+        rom[0x147] = 0x00; // ROM ONLY
+        rom[0x148] = 0x00; // 32 KiB
+        return rom;
+    }
+
+    struct RunResult
+    {
+        cpu_registers regs;
+        uint8_t f;
+        bool ime;
+        std::vector<uint8_t> ram;    // WRAM followed by HRAM
+        std::vector<uint8_t> screen; // Last completed frame
+        uint64_t idle_hits;
+        uint64_t bulk_hits;
+    };
+
+    RunResult run_rom(const std::string& path, bool use_cpu_run, bool idle_skip)
+    {
+        Emu emu(path, "");
+        emu.set_component_pointers();
+        emu.get_cpu().cpu_init();
+        emu.skip_bootrom();
+        Cpu& cpu = emu.get_cpu();
+        Ppu& ppu = emu.get_ppu();
+        uint64_t target = ppu.frame_count + FRAMES;
+        if (use_cpu_run) {
+            cpu.idle_skip = idle_skip;
+            cpu.cpu_run(target);
+        } else {
+            cpu.halt_skip = false;
+            while (ppu.frame_count < target)
+                cpu.cpu_step();
+        }
+
+        RunResult result{cpu.regs, cpu.read_f(), cpu.ime, {}, {}, cpu.idle_stats.hits, cpu.bulk_stats.hits};
+        Bus& bus = emu.get_bus();
+        for (uint32_t address = 0xC000; address < 0xE000; address++)
+            result.ram.push_back(bus.bus_read(static_cast<uint16_t>(address)));
+        for (uint32_t address = 0xFF80; address < 0xFFFF; address++)
+            result.ram.push_back(bus.bus_read(static_cast<uint16_t>(address)));
+        ppu.swap_buffers(); // Take the last published frame, as the headless runner does
+        result.screen.assign(ppu.get_screen_buffer(), ppu.get_screen_buffer() + PpuConstants::SCREEN_BUFFER_SIZE);
+        return result;
+    }
+
+    bool run_case(const RomCase& rom_case)
+    {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / ("cpu_run_test_" + rom_case.name + ".gb");
+        std::vector<uint8_t> rom = build_rom(rom_case);
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(rom.size()));
+
+        RunResult stepped = run_rom(path.string(), false, false);
+        RunResult run = run_rom(path.string(), true, rom_case.idle != IdleCheck::DISABLED);
+        std::filesystem::remove(path);
+
+        bool passed = true;
+        auto mismatch = [&](const std::string& what, unsigned expected, unsigned got) {
+            std::cerr << "  " << rom_case.name << ": " << what << " expected 0x" << std::hex << expected
+                      << ", got 0x" << got << std::dec << std::endl;
+            passed = false;
+        };
+        if (run.regs.a != stepped.regs.a || run.f != stepped.f)
+            mismatch("AF", (stepped.regs.a << 8) | stepped.f, (run.regs.a << 8) | run.f);
+        if (run.regs.bc != stepped.regs.bc)
+            mismatch("BC", stepped.regs.bc, run.regs.bc);
+        if (run.regs.de != stepped.regs.de)
+            mismatch("DE", stepped.regs.de, run.regs.de);
+        if (run.regs.hl != stepped.regs.hl)
+            mismatch("HL", stepped.regs.hl, run.regs.hl);
+        if (run.regs.sp != stepped.regs.sp)
+            mismatch("SP", stepped.regs.sp, run.regs.sp);
+        if (run.regs.pc != stepped.regs.pc)
+            mismatch("PC", stepped.regs.pc, run.regs.pc);
+        if (run.ime != stepped.ime)
+            mismatch("IME", stepped.ime, run.ime);
+        for (std::size_t i = 0; i < run.ram.size(); i++) {
+            if (run.ram[i] != stepped.ram[i]) {
+                unsigned address = static_cast<unsigned>(i < 0x2000 ? 0xC000 + i : 0xFF80 + (i - 0x2000));
+                std::cerr << "  " << rom_case.name << ": first memory difference at 0x" << std::hex << address << std::dec << std::endl;
+                mismatch("byte", stepped.ram[i], run.ram[i]);
+                break;
+            }
+        }
+        if (run.screen != stepped.screen) {
+            std::cerr << "  " << rom_case.name << ": last frames differ" << std::endl;
+            passed = false;
+        }
+        if ((rom_case.idle == IdleCheck::SKIPPED && run.idle_hits == 0) || (rom_case.idle == IdleCheck::DISABLED && run.idle_hits != 0)) {
+            std::cerr << "  " << rom_case.name << ": " << run.idle_hits << " idle loop skips" << std::endl;
+            passed = false;
+        }
+        if ((rom_case.bulk == BulkCheck::COPIED && run.bulk_hits == 0) || (rom_case.bulk == BulkCheck::FELL_BACK && run.bulk_hits != 0)) {
+            std::cerr << "  " << rom_case.name << ": " << run.bulk_hits << " bulk copy loops" << std::endl;
+            passed = false;
+        }
+        for (const auto& [address, value] : rom_case.expected) {
+            std::size_t index = 0x2000 + (address - 0xFF80);
+            if (stepped.ram[index] != value)
+                mismatch("cpu_step HRAM byte", value, stepped.ram[index]);
+            if (run.ram[index] != value)
+                mismatch("cpu_run HRAM byte", value, run.ram[index]);
+        }
+        return passed;
+    }
+
+    // Branch closing a copy/fill loop, back to its first instruction
+    enum class LoopBranch
+    {
+        JR_NZ,
+        JP_NZ
+    };
+
+    // A copy/fill loop case: setup runs at 0x0150 after DI; LD SP, 0xFFFE and jumps to the loop body at 0x0200, which
+    // is closed by the branch; the code after the loop ends in JR $. The loops use the ROM data at 0x4000-0x7FFF
+    RomCase loop_case(std::string name, std::vector<uint8_t> setup, std::vector<uint8_t> body, LoopBranch branch,
+                      std::vector<uint8_t> after, BulkCheck bulk,
+                      std::vector<std::pair<uint16_t, std::vector<uint8_t>>> handlers = {})
+    {
+        std::vector<uint8_t> start = {0xF3, 0x31, 0xFE, 0xFF}; // DI; LD SP, 0xFFFE
+        start.insert(start.end(), setup.begin(), setup.end());
+        start.insert(start.end(), {0xC3, 0x00, 0x02}); // JP 0x0200
+        if (branch == LoopBranch::JR_NZ)
+            body.insert(body.end(), {0x20, static_cast<uint8_t>(-static_cast<int>(body.size() + 2))});
+        else
+            body.insert(body.end(), {0xC2, 0x00, 0x02});
+        body.insert(body.end(), after.begin(), after.end());
+        body.insert(body.end(), {0x18, 0xFE}); // JR $
+
+        handlers.push_back({0x0100, {0x00, 0xC3, 0x50, 0x01}}); // NOP; JP 0x0150
+        handlers.push_back({0x0150, start});
+        handlers.push_back({0x0200, body});
+        return {std::move(name), std::move(handlers), {}, IdleCheck::NONE, bulk};
+    }
+
+    // LD HL, 0x4000; LD DE, 0xC000; LD B, 0; then copy 256 bytes with a loop of its own, so WRAM holds distinct bytes
+    const std::vector<uint8_t> FILL_WRAM_PAGE = {0x21, 0x00, 0x40, 0x11, 0x00, 0xC0, 0x06, 0x00,
+                                                 0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA}; // LD A, (HL+); LD (DE), A; INC DE; DEC B; JR NZ
+
+    // Waits for VBlank, turns the LCD off, copies count bytes from one address to WRAM at another and turns the LCD
+    // back on, so VRAM and OAM contents reach the compared memory
+    std::vector<uint8_t> read_back(uint16_t from, uint16_t to, uint16_t count)
+    {
+        return {0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA,             // LDH A, (LY); CP 0x90; JR NZ
+                0xAF, 0xE0, 0x40,                               // XOR A; LDH (LCDC), A
+                0x21, static_cast<uint8_t>(from), static_cast<uint8_t>(from >> 8),
+                0x11, static_cast<uint8_t>(to), static_cast<uint8_t>(to >> 8),
+                0x01, static_cast<uint8_t>(count), static_cast<uint8_t>(count >> 8),
+                0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, // LD A, (HL+); LD (DE), A; INC DE; DEC BC; LD A, B; OR C; JR NZ
+                0x3E, 0x91, 0xE0, 0x40};                        // LD A, 0x91; LDH (LCDC), A
+    }
+
+    std::vector<uint8_t> concat(std::vector<uint8_t> first, const std::vector<uint8_t>& second)
+    {
+        first.insert(first.end(), second.begin(), second.end());
+        return first;
+    }
+
+    // Timer interrupt handler for the loop cases: appends A, F, B and C to a 256-byte log at 0xD800, its next index in
+    // 0xFF82, and counts interrupts in 0xFF83
+    const std::vector<std::pair<uint16_t, std::vector<uint8_t>>> TIMER_LOG_HANDLER = {
+        {0x0050, {0xF5, 0xE5, 0xD5,             // PUSH AF; PUSH HL; PUSH DE
+                  0xF8, 0x04,                   // LD HL, SP+4
+                  0x2A, 0x57, 0x7E, 0x5F,       // LD A, (HL+); LD D, A; LD A, (HL); LD E, A (F and A as pushed)
+                  0xF0, 0x82, 0x6F, 0x26, 0xD8, // LDH A, (0x82); LD L, A; LD H, 0xD8
+                  0x7B, 0x22, 0x7A, 0x22,       // LD A, E; LD (HL+), A; LD A, D; LD (HL+), A
+                  0x78, 0x22, 0x79, 0x22,       // LD A, B; LD (HL+), A; LD A, C; LD (HL+), A
+                  0x7D, 0xE0, 0x82,             // LD A, L; LDH (0x82), A
+                  0xF0, 0x83, 0x3C, 0xE0, 0x83, // LDH A, (0x83); INC A; LDH (0x83), A
+                  0xD1, 0xE1, 0xF1, 0xD9}},     // POP DE; POP HL; POP AF; RETI
+    };
+
+    const std::vector<uint8_t> TIMER_OFF = {0xAF, 0xE0, 0xFF}; // XOR A; LDH (IE), A
+
+    // Loop setup run with the timer overflowing every 256 M-cycles into TIMER_LOG_HANDLER, ending in EI
+    std::vector<uint8_t> under_timer(const std::vector<uint8_t>& setup)
+    {
+        std::vector<uint8_t> bytes = {0x3E, 0xC0, 0xE0, 0x06,  // LD A, 0xC0; LDH (TMA), A
+                                      0x3E, 0x05, 0xE0, 0x07,  // LD A, 0x05; LDH (TAC), A
+                                      0x3E, 0x04, 0xE0, 0xFF,  // LD A, 0x04; LDH (IE), A
+                                      0xAF, 0xE0, 0x0F,        // XOR A; LDH (IF), A
+                                      0xE0, 0x82, 0xE0, 0x83}; // LDH (0x82), A; LDH (0x83), A
+        bytes.insert(bytes.end(), setup.begin(), setup.end());
+        bytes.push_back(0xFB); // EI
+        return bytes;
+    }
+
+    // Adds a copy of every case that expects idle loop skips, run with Cpu::idle_skip off
+    std::vector<RomCase> with_idle_skip_off(std::vector<RomCase> cases)
+    {
+        std::size_t count = cases.size();
+        for (std::size_t i = 0; i < count; i++) {
+            if (cases[i].idle != IdleCheck::SKIPPED)
+                continue;
+            RomCase disabled = cases[i];
+            disabled.name += "_no_idle_skip";
+            disabled.idle = IdleCheck::DISABLED;
+            cases.push_back(disabled);
+        }
+        return cases;
+    }
+
+    const std::vector<RomCase> CASES = with_idle_skip_off({
+        {
+            // EI; JP into a copy loop with the timer interrupt already pending: the interrupt is taken after the
+            // loop's first instruction, before any byte is stored, so the handler sees the whole count in BC
+            "ei_into_copy_loop",
+            {
+                {0x0050, {0xF5,               // PUSH AF
+                          0x78, 0xE0, 0x80,   // LD A, B; LDH (0x80), A
+                          0x79, 0xE0, 0x81,   // LD A, C; LDH (0x81), A
+                          0xF1, 0xD9}},       // POP AF; RETI
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,               // DI
+                          0x31, 0xFE, 0xFF,   // LD SP, 0xFFFE
+                          0x3E, 0x04, 0xE0, 0xFF, // LD A, 0x04; LDH (IE), A
+                          0xE0, 0x0F,         // LDH (IF), A
+                          0x21, 0x00, 0x40,   // LD HL, 0x4000
+                          0x11, 0x00, 0xC0,   // LD DE, 0xC000
+                          0x01, 0x00, 0x08,   // LD BC, 0x0800
+                          0xFB,               // EI
+                          0xC3, 0x70, 0x01}}, // JP 0x0170
+                {0x0170, {0x2A,               // LD A, (HL+)
+                          0x12, 0x13,         // LD (DE), A; INC DE
+                          0x0B, 0x78, 0xB1,   // DEC BC; LD A, B; OR C
+                          0x20, 0xF8,         // JR NZ, 0x0170
+                          0x18, 0xFE}},       // JR $
+            },
+            {{0xFF80, 0x08}, {0xFF81, 0x00}},
+        },
+        {
+            // Superinstructions under a timer interrupt every 256 M-cycles: DEC B / JR NZ, LDH A, (TIMA) / CP u8 / JR C
+            // and LDH A, (TIMA) / CP u8 / JR NZ run back to back, so overflows land on every member of each sequence.
+            // The handler logs A, F, B and the return address for the first 16 interrupts, in the order the stepped run takes them
+            "fused_sequences_under_timer",
+            {
+                {0x0050, {0xF5, 0xC5, 0xD5, 0xE5, // PUSH AF; PUSH BC; PUSH DE; PUSH HL
+                          0x50, 0xF5, 0xC1,   // LD D, B; PUSH AF; POP BC
+                          0xF8, 0x08, 0x5E,   // LD HL, SP+8; LD E, (HL) (return address, low byte)
+                          0xF0, 0x80, 0xFE, 0xD0, // LDH A, (0x80); CP 0xD0
+                          0x30, 0x0E,         // JR NC, 0x006E (log full)
+                          0x6F, 0x26, 0xFF,   // LD L, A; LD H, 0xFF
+                          0x78, 0x22,         // LD A, B; LD (HL+), A (A)
+                          0x79, 0x22,         // LD A, C; LD (HL+), A (F)
+                          0x7A, 0x22,         // LD A, D; LD (HL+), A (B)
+                          0x7B, 0x22,         // LD A, E; LD (HL+), A (PC)
+                          0x7D, 0xE0, 0x80,   // LD A, L; LDH (0x80), A
+                          0xF0, 0x81, 0x3C, 0xE0, 0x81, // LDH A, (0x81); INC A; LDH (0x81), A
+                          0xE1, 0xD1, 0xC1, 0xF1, 0xD9}}, // POP HL; POP DE; POP BC; POP AF; RETI
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,               // DI
+                          0x31, 0xFE, 0xFF,   // LD SP, 0xFFFE
+                          0x3E, 0xC0, 0xE0, 0x06, // LD A, 0xC0; LDH (TMA), A
+                          0x3E, 0x05, 0xE0, 0x07, // LD A, 0x05; LDH (TAC), A
+                          0x3E, 0x04, 0xE0, 0xFF, // LD A, 0x04; LDH (IE), A
+                          0xAF, 0xE0, 0x0F,   // XOR A; LDH (IF), A
+                          0xE0, 0x81,         // LDH (0x81), A
+                          0x3E, 0x90, 0xE0, 0x80, // LD A, 0x90; LDH (0x80), A
+                          0xFB,               // EI
+                          0xC3, 0x00, 0x02}}, // JP 0x0200
+                {0x0200, {0x06, 0x07,         // LD B, 0x07
+                          0x05, 0x20, 0xFD,   // DEC B; JR NZ, 0x0202
+                          0xF0, 0x05, 0xFE, 0xF8, // LDH A, (TIMA); CP 0xF8
+                          0x38, 0xF5,         // JR C, 0x0200
+                          0xF0, 0x05, 0xFE, 0xFC, // LDH A, (TIMA); CP 0xFC
+                          0x20, 0xEF,         // JR NZ, 0x0200
+                          0x18, 0xED}},       // JR 0x0200
+            },
+            hram_bytes(0xFF80, {0xD0, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Log index, interrupts taken modulo 256
+                                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                0xFF, 0x40, 0x00, 0x0D, 0xFA, 0x50, 0x03, 0x02, // A, F, B and the return address at each interrupt
+                                0xFD, 0x40, 0x07, 0x02, 0xFF, 0xD0, 0x00, 0x07,
+                                0xFB, 0x50, 0x04, 0x03, 0xFE, 0x40, 0x00, 0x0F,
+                                0xF7, 0xD0, 0x00, 0x03, 0xFA, 0x50, 0x04, 0x02,
+                                0xFE, 0x40, 0x00, 0x00, 0xF6, 0xD0, 0x00, 0x05,
+                                0xFA, 0x50, 0x03, 0x03, 0xFD, 0x40, 0x07, 0x02,
+                                0xFF, 0xD0, 0x00, 0x07, 0xFB, 0x50, 0x05, 0x02,
+                                0xFF, 0x40, 0x00, 0x0F, 0xF7, 0x50, 0x01, 0x02}),
+        },
+        {
+            // Register-only ALU chain (the code the x86-64 translator lowers) under a timer interrupt every 64
+            // M-cycles. Each carry-in (ADC/SBC, INC/DEC) follows a different kind of flag op, and the handler records
+            // A, F and a count, so an interrupt taken at the wrong instruction shows up in HRAM
+            "alu_chain_under_timer",
+            {
+                {0x0050, {0xF5, 0xC5,         // PUSH AF; PUSH BC
+                          0xF5, 0xC1,         // PUSH AF; POP BC
+                          0x79, 0xE0, 0x84,   // LD A, C; LDH (0x84), A
+                          0x78, 0xE0, 0x83,   // LD A, B; LDH (0x83), A
+                          0xF0, 0x82, 0x3C, 0xE0, 0x82, // LDH A, (0x82); INC A; LDH (0x82), A
+                          0xC1, 0xF1, 0xD9}}, // POP BC; POP AF; RETI
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,               // DI
+                          0x31, 0xFE, 0xFF,   // LD SP, 0xFFFE
+                          0x3E, 0xF0, 0xE0, 0x06, // LD A, 0xF0; LDH (TMA), A
+                          0x3E, 0x05, 0xE0, 0x07, // LD A, 0x05; LDH (TAC), A
+                          0x3E, 0x04, 0xE0, 0xFF, // LD A, 0x04; LDH (IE), A
+                          0xAF, 0xE0, 0x0F,   // XOR A; LDH (IF), A
+                          0x01, 0x34, 0x12,   // LD BC, 0x1234
+                          0x11, 0x78, 0x56,   // LD DE, 0x5678
+                          0x21, 0xBC, 0x9A,   // LD HL, 0x9ABC
+                          0xFB,               // EI
+                          0xC3, 0x00, 0x02}}, // JP 0x0200
+                {0x0200, {0x78, 0x81, 0x8A,   // LD A, B; ADD A, C; ADC A, D
+                          0x5F, 0xDE, 0x13,   // LD E, A; SBC A, 0x13
+                          0x2C, 0x25, 0xA8,   // INC L; DEC H; XOR B
+                          0x8B, 0x47, 0x03,   // ADC A, E; LD B, A; INC BC
+                          0x91, 0x9C, 0x57,   // SUB C; SBC A, H; LD D, A
+                          0xBD, 0x8F, 0x4F,   // CP L; ADC A, A; LD C, A
+                          0x0D, 0x0C, 0x8D,   // DEC C; INC C; ADC A, L
+                          0x67, 0xCE, 0x01,   // LD H, A; ADC A, 0x01
+                          0x3D, 0x9F, 0x1B,   // DEC A; SBC A, A; DEC DE
+                          0xB3, 0xA2, 0x98,   // OR E; AND D; SBC A, B
+                          0x18, 0xE0}},       // JR 0x0200
+            },
+            {},
+        },
+        {
+            // HALT loop woken by the timer (every 64 M-cycles) and VBlank. The handlers log DIV, TIMA and LY into WRAM
+            // through HL, so waking a cycle early or late from the fast-forward changes the log
+            "halt_timer_vblank",
+            {
+                {0x0040, {0xF5, 0x3E, 0x01, 0x22, // PUSH AF; LD A, 0x01; LD (HL+), A
+                          0xC3, 0x60, 0x00}},     // JP 0x0060
+                {0x0050, {0xF5, 0x3E, 0x04, 0x22, // PUSH AF; LD A, 0x04; LD (HL+), A
+                          0xC3, 0x60, 0x00}},     // JP 0x0060
+                {0x0060, {0xF0, 0x04, 0x22,       // LDH A, (DIV); LD (HL+), A
+                          0xF0, 0x05, 0x22,       // LDH A, (TIMA); LD (HL+), A
+                          0xF0, 0x44, 0x22,       // LDH A, (LY); LD (HL+), A
+                          0xF0, 0x80, 0x3C, 0xE0, 0x80, // LDH A, (0x80); INC A; LDH (0x80), A
+                          0xF1, 0xD9}},           // POP AF; RETI
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,                   // DI
+                          0x31, 0xFE, 0xFF,       // LD SP, 0xFFFE
+                          0x21, 0x00, 0xC0,       // LD HL, 0xC000
+                          0x3E, 0xF0, 0xE0, 0x06, // LD A, 0xF0; LDH (TMA), A
+                          0x3E, 0x05, 0xE0, 0x07, // LD A, 0x05; LDH (TAC), A
+                          0x3E, 0x05, 0xE0, 0xFF, // LD A, 0x05; LDH (IE), A
+                          0xAF, 0xE0, 0x0F,       // XOR A; LDH (IF), A
+                          0xE0, 0x80,             // LDH (0x80), A
+                          0xFB}},                 // EI
+                {0x0169, {0x76,                   // HALT
+                          0x00,                   // NOP
+                          0x18, 0xFC}},           // JR 0x0169
+            },
+            {{0xFF80, 0x29}}, // Interrupts taken, modulo 256
+        },
+        {
+            // LY polled with LDH A, (LY) / CP / JR NZ until VBlank, then until it moves on. TIMA (one tick per 4
+            // M-cycles) and DIV are logged to WRAM when each wait ends, so a skip that overshoots LY's change fails
+            "idle_ly_poll",
+            {
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,                   // DI
+                          0x31, 0xFE, 0xFF,       // LD SP, 0xFFFE
+                          0x21, 0x00, 0xC0,       // LD HL, 0xC000
+                          0x3E, 0x05, 0xE0, 0x07, // LD A, 0x05; LDH (TAC), A
+                          0xAF, 0xE0, 0x0F,       // XOR A; LDH (IF), A
+                          0xE0, 0xFF, 0xE0, 0x80, // LDH (IE), A; LDH (0x80), A
+                          0xC3, 0x00, 0x02}},     // JP 0x0200
+                {0x0200, {0xF0, 0x44, 0xFE, 0x90, // LDH A, (LY); CP 0x90
+                          0x20, 0xFA,             // JR NZ, 0x0200
+                          0xF0, 0x05, 0x22,       // LDH A, (TIMA); LD (HL+), A
+                          0xF0, 0x04, 0x22,       // LDH A, (DIV); LD (HL+), A
+                          0xF0, 0x80, 0x3C, 0xE0, 0x80, // LDH A, (0x80); INC A; LDH (0x80), A
+                          0xF0, 0x44, 0xFE, 0x90, // LDH A, (LY); CP 0x90
+                          0x28, 0xFA,             // JR Z, 0x0211
+                          0x18, 0xE7}},           // JR 0x0200
+            },
+            {{0xFF80, 0x03}}, // Frames seen
+            IdleCheck::SKIPPED,
+        },
+        {
+            // STAT mode polled with LDH A, (STAT) / AND 3 / JR NZ until HBlank, then until it ends, logging TIMA and LY
+            "idle_stat_mode_poll",
+            {
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,                   // DI
+                          0x31, 0xFE, 0xFF,       // LD SP, 0xFFFE
+                          0x21, 0x00, 0xC0,       // LD HL, 0xC000
+                          0x3E, 0x05, 0xE0, 0x07, // LD A, 0x05; LDH (TAC), A
+                          0xAF, 0xE0, 0x0F,       // XOR A; LDH (IF), A
+                          0xE0, 0xFF, 0xE0, 0x80, // LDH (IE), A; LDH (0x80), A
+                          0xC3, 0x00, 0x02}},     // JP 0x0200
+                {0x0200, {0xF0, 0x41, 0xE6, 0x03, // LDH A, (STAT); AND 0x03
+                          0x20, 0xFA,             // JR NZ, 0x0200
+                          0xF0, 0x05, 0x22,       // LDH A, (TIMA); LD (HL+), A
+                          0xF0, 0x44, 0x22,       // LDH A, (LY); LD (HL+), A
+                          0xF0, 0x80, 0x3C, 0xE0, 0x80, // LDH A, (0x80); INC A; LDH (0x80), A
+                          0xF0, 0x41, 0xE6, 0x03, // LDH A, (STAT); AND 0x03
+                          0x28, 0xFA,             // JR Z, 0x0211
+                          0x18, 0xE7}},           // JR 0x0200
+            },
+            {},
+            IdleCheck::SKIPPED,
+        },
+        {
+            // HRAM flag polled with LD A, (u16) / AND A / JR Z and set by the VBlank handler, the main loop clears it
+            // and logs TIMA and LY each time it sees it
+            "idle_hram_flag_poll",
+            {
+                {0x0040, {0xF5, 0x3E, 0x01,       // PUSH AF; LD A, 0x01
+                          0xE0, 0x81,             // LDH (0x81), A
+                          0xF1, 0xD9}},           // POP AF; RETI
+                {0x0100, {0x00, 0xC3, 0x50, 0x01}}, // NOP; JP 0x0150
+                {0x0150, {0xF3,                   // DI
+                          0x31, 0xFE, 0xFF,       // LD SP, 0xFFFE
+                          0x21, 0x00, 0xC0,       // LD HL, 0xC000
+                          0x3E, 0x05, 0xE0, 0x07, // LD A, 0x05; LDH (TAC), A
+                          0xAF, 0xE0, 0x0F,       // XOR A; LDH (IF), A
+                          0xE0, 0x80, 0xE0, 0x81, // LDH (0x80), A; LDH (0x81), A
+                          0x3E, 0x01, 0xE0, 0xFF, // LD A, 0x01; LDH (IE), A
+                          0xFB,                   // EI
+                          0xC3, 0x00, 0x02}},     // JP 0x0200
+                {0x0200, {0xFA, 0x81, 0xFF,       // LD A, (0xFF81)
+                          0xA7, 0x28, 0xFA,       // AND A; JR Z, 0x0200
+                          0xAF, 0xEA, 0x81, 0xFF, // XOR A; LD (0xFF81), A
+                          0xF0, 0x05, 0x22,       // LDH A, (TIMA); LD (HL+), A
+                          0xF0, 0x44, 0x22,       // LDH A, (LY); LD (HL+), A
+                          0xF0, 0x80, 0x3C, 0xE0, 0x80, // LDH A, (0x80); INC A; LDH (0x80), A
+                          0x18, 0xE9}},           // JR 0x0200
+            },
+            {{0xFF80, 0x02}}, // Flags seen, the run ends as the third VBlank is taken
+            IdleCheck::SKIPPED,
+        },
+        // Each load and store pair of the bulk loop matcher, with 8-bit and 16-bit counters
+        loop_case("copy_hl_inc_to_de_dec_b",
+                  {0x21, 0x00, 0x40, 0x11, 0x00, 0xC0, 0x06, 0x80}, // LD HL, 0x4000; LD DE, 0xC000; LD B, 0x80
+                  {0x2A, 0x12, 0x13, 0x05},                         // LD A, (HL+); LD (DE), A; INC DE; DEC B
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_de_to_hl_inc_dec_c",
+                  {0x11, 0x00, 0x40, 0x21, 0x00, 0xC1, 0x0E, 0x00}, // LD DE, 0x4000; LD HL, 0xC100; LD C, 0 (256 bytes)
+                  {0x1A, 0x22, 0x13, 0x0D},                         // LD A, (DE); LD (HL+), A; INC DE; DEC C
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_bc_to_hl_dec_d",
+                  {0x01, 0x10, 0x40, 0x21, 0x00, 0xC2, 0x16, 0x40}, // LD BC, 0x4010; LD HL, 0xC200; LD D, 0x40
+                  {0x0A, 0x77, 0x03, 0x23, 0x15},                   // LD A, (BC); LD (HL), A; INC BC; INC HL; DEC D
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_hl_to_bc_dec_e",
+                  {0x21, 0x20, 0x40, 0x01, 0x00, 0xC3, 0x1E, 0x33}, // LD HL, 0x4020; LD BC, 0xC300; LD E, 0x33
+                  {0x7E, 0x02, 0x23, 0x03, 0x1D},                   // LD A, (HL); LD (BC), A; INC HL; INC BC; DEC E
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_dec_bc_ld_a_b_or_c",
+                  {0x21, 0x00, 0x41, 0x11, 0x00, 0xC4, 0x01, 0x00, 0x06}, // LD HL, 0x4100; LD DE, 0xC400; LD BC, 0x0600
+                  {0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1},                   // LD A, (HL+); LD (DE), A; INC DE; DEC BC; LD A, B; OR C
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_dec_bc_ld_a_c_or_b_jp_nz",
+                  {0x21, 0x00, 0x42, 0x11, 0x00, 0xCA, 0x01, 0x01, 0x03}, // LD HL, 0x4200; LD DE, 0xCA00; LD BC, 0x0301
+                  {0x2A, 0x12, 0x13, 0x0B, 0x79, 0xB0},                   // LD A, (HL+); LD (DE), A; INC DE; DEC BC; LD A, C; OR B
+                  LoopBranch::JP_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_dec_de_ld_a_e_or_d",
+                  {0x21, 0x00, 0x43, 0x01, 0x00, 0xD0, 0x11, 0x00, 0x02}, // LD HL, 0x4300; LD BC, 0xD000; LD DE, 0x0200
+                  {0x2A, 0x02, 0x03, 0x1B, 0x7B, 0xB2},                   // LD A, (HL+); LD (BC), A; INC BC; DEC DE; LD A, E; OR D
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        // Fills from LD A, u8, XOR A and a preset A
+        loop_case("fill_ld_a_u8",
+                  {0x21, 0x00, 0xC0, 0x0E, 0x00}, // LD HL, 0xC000; LD C, 0
+                  {0x3E, 0x5A, 0x22, 0x0D},       // LD A, 0x5A; LD (HL+), A; DEC C
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("fill_xor_a",
+                  concat(FILL_WRAM_PAGE, {0x21, 0x40, 0xC0, 0x06, 0x80}), // LD HL, 0xC040; LD B, 0x80
+                  {0xAF, 0x22, 0x05},                                     // XOR A; LD (HL+), A; DEC B
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("fill_a",
+                  {0x3E, 0x77, 0x11, 0x00, 0xC8, 0x06, 0x90}, // LD A, 0x77; LD DE, 0xC800; LD B, 0x90
+                  {0x12, 0x13, 0x05},                         // LD (DE), A; INC DE; DEC B
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        // Destination three bytes ahead of the source: every store is read back three iterations later
+        loop_case("copy_overlapping",
+                  concat(FILL_WRAM_PAGE, {0x21, 0x00, 0xC0, 0x11, 0x03, 0xC0, 0x06, 0xF0}), // LD HL, 0xC000; LD DE, 0xC003; LD B, 0xF0
+                  {0x2A, 0x12, 0x13, 0x05},
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        // Echo RAM destinations, the second one overlapping its WRAM source through the mirror
+        loop_case("copy_to_echo_ram",
+                  {0x21, 0x00, 0x44, 0x11, 0x00, 0xE1, 0x01, 0x00, 0x04}, // LD HL, 0x4400; LD DE, 0xE100; LD BC, 0x0400
+                  {0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1},
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        loop_case("copy_wram_into_its_echo",
+                  concat(FILL_WRAM_PAGE, {0x21, 0x00, 0xC0, 0x11, 0x01, 0xE0, 0x06, 0xC0}), // LD HL, 0xC000; LD DE, 0xE001; LD B, 0xC0
+                  {0x2A, 0x12, 0x13, 0x05},
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED),
+        // VRAM with the LCD on: stores in mode 3 are dropped, so the bulk path has to stop at each lock. Tile 0 fills
+        // the screen before and after the copy, so a stale decoded tile shows up in the last frame
+        loop_case("copy_to_vram_lcd_on",
+                  {0x21, 0x00, 0x40, 0x11, 0x00, 0x80, 0x01, 0x00, 0x02}, // LD HL, 0x4000; LD DE, 0x8000; LD BC, 0x0200
+                  {0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1},
+                  LoopBranch::JR_NZ, read_back(0x8000, 0xC000, 0x0200), BulkCheck::COPIED),
+        // OAM and HRAM have no bulk write pages, these loops must run one instruction at a time
+        loop_case("copy_to_oam_falls_back",
+                  {0x21, 0x00, 0x40, 0x11, 0x00, 0xFE, 0x06, 0xA0}, // LD HL, 0x4000; LD DE, 0xFE00; LD B, 0xA0
+                  {0x2A, 0x12, 0x13, 0x05},
+                  LoopBranch::JR_NZ, read_back(0xFE00, 0xC000, 0x00A0), BulkCheck::FELL_BACK),
+        loop_case("copy_to_hram_falls_back",
+                  {0x21, 0x00, 0x40, 0x11, 0x80, 0xFF, 0x06, 0x70}, // LD HL, 0x4000; LD DE, 0xFF80; LD B, 0x70
+                  {0x2A, 0x12, 0x13, 0x05},
+                  LoopBranch::JR_NZ, {}, BulkCheck::FELL_BACK),
+        // A copy loop in WRAM has no block, so it runs one instruction at a time (the computed-goto labels in the
+        // threaded build) and returns into ROM, where the next loop must go back to the bulk path
+        loop_case("copy_loop_in_wram_then_rom",
+                  concat({0x21, 0x00, 0x03, 0x11, 0x00, 0xC0, 0x06, 0x0F, // LD HL, 0x0300; LD DE, 0xC000; LD B, 0x0F
+                          0x2A, 0x12, 0x1C, 0x05, 0x20, 0xFA,             // Copy the routine at 0x0300 (INC E: no bulk)
+                          0xCD, 0x00, 0xC0},                              // CALL 0xC000
+                         {0x21, 0x00, 0x41, 0x11, 0x00, 0xCA, 0x06, 0x80}), // LD HL, 0x4100; LD DE, 0xCA00; LD B, 0x80
+                  {0x2A, 0x12, 0x13, 0x05},
+                  LoopBranch::JR_NZ, {}, BulkCheck::COPIED,
+                  {{0x0300, {0x21, 0x00, 0x40, 0x11, 0x00, 0xC8, 0x06, 0x80, // LD HL, 0x4000; LD DE, 0xC800; LD B, 0x80
+                             0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA,             // LD A, (HL+); LD (DE), A; INC DE; DEC B; JR NZ
+                             0xC9}}}),                                       // RET
+        // Timer interrupt every 256 M-cycles during the loops below: the handler logs A, F, B and C, so a bulk run that
+        // crosses the overflow, or leaves A or F other than the last iteration would, records different bytes
+        loop_case("copy_dec_bc_under_timer",
+                  under_timer({0x21, 0x00, 0x40, 0x11, 0x00, 0xC0, 0x01, 0x00, 0x08}), // LD HL, 0x4000; LD DE, 0xC000; LD BC, 0x0800
+                  {0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1},
+                  LoopBranch::JR_NZ, TIMER_OFF, BulkCheck::COPIED, TIMER_LOG_HANDLER),
+        loop_case("copy_dec_b_under_timer",
+                  under_timer({0x21, 0x00, 0x40, 0x11, 0x00, 0xC0, 0x06, 0x00}), // LD HL, 0x4000; LD DE, 0xC000; LD B, 0
+                  {0x2A, 0x12, 0x13, 0x05},
+                  LoopBranch::JR_NZ, TIMER_OFF, BulkCheck::COPIED, TIMER_LOG_HANDLER),
+        loop_case("fill_xor_a_under_timer",
+                  under_timer({0x21, 0x00, 0xC0, 0x06, 0x00}), // LD HL, 0xC000; LD B, 0
+                  {0xAF, 0x22, 0x05},
+                  LoopBranch::JR_NZ, TIMER_OFF, BulkCheck::COPIED, TIMER_LOG_HANDLER),
+    });
+}
+
+int main()
+{
+    std::cout << "cpu_run: " << Cpu::dispatch_mode() << std::endl; // Idle and bulk expectations hold in every build
+    int failed = 0;
+    for (const RomCase& rom_case : CASES) {
+        bool passed = run_case(rom_case);
+        std::cout << (passed ? "✓ " : "✗ ") << rom_case.name << std::endl;
+        failed += passed ? 0 : 1;
+    }
+    std::cout << std::dec << "\n" << CASES.size() - failed << "/" << CASES.size() << " ROM cases passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "emu.h"
+#include "interrupts.h"
+
+// Connects two instances with PeerSerialSink and steps whichever is behind on the master clock. The master starts
+// a transfer on its internal clock, the slave waits on the external clock: checks that the SB bytes are swapped,
+// that the master's IT_Serial comes TRANSFER_CYCLES after the start, and that the slave's comes from its own
+// SERIAL event (raised while the slave runs, not while the master does) within an instruction of the master's.
+// Also checks a transfer into BufferSerialSink
+
+namespace {
+    constexpr std::size_t ROM_SIZE = 0x8000; // 32 KiB, ROM ONLY
+    constexpr uint64_t MAX_CYCLES = 4 * Serial::TRANSFER_CYCLES;
+    constexpr uint64_t MAX_SKEW = 24; // Longest instruction in T-cycles
+    constexpr uint8_t IT_SERIAL = static_cast<uint8_t>(Interrupts::InterruptMask::IT_Serial);
+
+    // Writes SB, clears IF, writes SC, then counts in B forever (no HALT, no idle loop)
+    std::vector<uint8_t> build_rom(uint8_t sb, uint8_t sc)
+    {
+        std::vector<uint8_t> rom(ROM_SIZE, 0x00);
+        const std::vector<uint8_t> entry = {0x00, 0xC3, 0x50, 0x01}; // NOP; JP 0x0150
+        const std::vector<uint8_t> code = {0x3E, sb, 0xE0, 0x01,    // LD A, sb; LDH (SB), A
+                                           0xAF, 0xE0, 0x0F,        // XOR A; LDH (IF), A
+                                           0x3E, sc, 0xE0, 0x02,    // LD A, sc; LDH (SC), A
+                                           0x04, 0x18, 0xFD};       // INC B; JR -3
+        std::copy(entry.begin(), entry.end(), rom.begin() + 0x0100);
+        std::copy(code.begin(), code.end(), rom.begin() + 0x0150);
+        rom[0x147] = 0x00; // ROM ONLY
+        rom[0x148] = 0x00; // 32 KiB
+        return rom;
+    }
+
+    std::unique_ptr<Emu> start(const std::string& name, uint8_t sb, uint8_t sc)
+    {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / ("serial_link_test_" + name + ".gb");
+        std::vector<uint8_t> rom = build_rom(sb, sc);
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(rom.size()));
+        auto emu = std::make_unique<Emu>(path.string(), "");
+        std::filesystem::remove(path);
+        emu->set_component_pointers();
+        emu->get_cpu().cpu_init();
+        emu->skip_bootrom();
+        return emu;
+    }
+
+    // Master clock time at the start of the instruction that armed SC, and after the one that raised IT_Serial
+    struct Transfer
+    {
+        uint64_t started = Scheduler::NEVER;
+        uint64_t done = Scheduler::NEVER;
+    };
+
+    // Runs one instruction and records the transfer times (the SC write schedules from the instruction's start)
+    void step(Emu& emu, Transfer& transfer)
+    {
+        Bus& bus = emu.get_bus();
+        bool raised = bus.bus_read(0xFF0F) & IT_SERIAL;
+        uint64_t before = emu.get_scheduler().now;
+        emu.get_cpu().cpu_step();
+        if (transfer.started == Scheduler::NEVER && (bus.bus_read(0xFF02) & 0x80))
+            transfer.started = before;
+        if (transfer.done == Scheduler::NEVER && !raised && (bus.bus_read(0xFF0F) & IT_SERIAL))
+            transfer.done = emu.get_scheduler().now;
+    }
+
+    // Completion lands TRANSFER_CYCLES after the start, seen at the end of the instruction it fell in
+    bool took_transfer_cycles(const Transfer& transfer)
+    {
+        uint64_t took = transfer.done - transfer.started;
+        return transfer.done != Scheduler::NEVER && took >= Serial::TRANSFER_CYCLES && took < Serial::TRANSFER_CYCLES + MAX_SKEW;
+    }
+
+    bool check(const std::string& name, bool ok, const std::string& what)
+    {
+        if (!ok)
+            std::cerr << "  " << name << ": " << what << std::endl;
+        return ok;
+    }
+
+    // Master on the internal clock, slave armed with slave_sc (0x80 waits on the external clock)
+    bool run_link(const std::string& name, uint8_t slave_sc)
+    {
+        std::unique_ptr<Emu> master = start(name + "_master", 0x5A, 0x81);
+        std::unique_ptr<Emu> slave = start(name + "_slave", 0xA5, slave_sc);
+        master->get_serial().set_sink(std::make_unique<PeerSerialSink>(slave->get_serial()));
+        slave->get_serial().set_sink(std::make_unique<PeerSerialSink>(master->get_serial()));
+
+        Transfer master_transfer, slave_transfer;
+        bool raised_by_master_step = false;
+        uint64_t end = master->get_scheduler().now + MAX_CYCLES;
+        while (master->get_scheduler().now < end || slave->get_scheduler().now < end) {
+            if (master->get_scheduler().now <= slave->get_scheduler().now) {
+                bool slave_raised = slave->get_bus().bus_read(0xFF0F) & IT_SERIAL;
+                step(*master, master_transfer);
+                raised_by_master_step |= !slave_raised && (slave->get_bus().bus_read(0xFF0F) & IT_SERIAL);
+            } else {
+                step(*slave, slave_transfer);
+            }
+        }
+
+        bool passed = true;
+        uint8_t master_sb = master->get_bus().bus_read(0xFF01);
+        uint8_t slave_sb = slave->get_bus().bus_read(0xFF01);
+        passed &= check(name, took_transfer_cycles(master_transfer),
+                        "master transfer took " + std::to_string(master_transfer.done - master_transfer.started) + " T-cycles");
+        passed &= check(name, !(master->get_bus().bus_read(0xFF02) & 0x80), "master SC bit 7 still set");
+        passed &= check(name, !raised_by_master_step, "slave IF raised while the master was running");
+        if (slave_sc == 0x80) {
+            passed &= check(name, master_sb == 0xA5, "master SB " + std::to_string(master_sb) + ", expected the slave's 0xA5");
+            passed &= check(name, slave_sb == 0x5A, "slave SB " + std::to_string(slave_sb) + ", expected the master's 0x5A");
+            if (check(name, slave_transfer.done != Scheduler::NEVER, "slave transfer never completed")) {
+                uint64_t skew = std::max(slave_transfer.done, master_transfer.done) - std::min(slave_transfer.done, master_transfer.done);
+                passed &= check(name, skew <= MAX_SKEW, "slave completed " + std::to_string(skew) + " T-cycles away from the master");
+            } else {
+                passed = false;
+            }
+            passed &= check(name, !(slave->get_bus().bus_read(0xFF02) & 0x80), "slave SC bit 7 still set");
+        } else {
+            // Not armed: the line stays high and the slave keeps its byte
+            passed &= check(name, master_sb == 0xFF, "master SB " + std::to_string(master_sb) + ", expected 0xFF");
+            passed &= check(name, slave_sb == 0xA5, "slave SB " + std::to_string(slave_sb) + ", expected 0xA5");
+            passed &= check(name, slave_transfer.done == Scheduler::NEVER, "slave raised IT_Serial without a transfer");
+        }
+        return passed;
+    }
+
+    // Internal clock transfer into BufferSerialSink: the byte is kept and 0xFF shifts in
+    bool run_buffer(const std::string& name)
+    {
+        std::unique_ptr<Emu> emu = start(name, 0x5A, 0x81);
+        emu->get_serial().set_sink(std::make_unique<BufferSerialSink>());
+        Transfer transfer;
+        uint64_t end = emu->get_scheduler().now + MAX_CYCLES;
+        while (emu->get_scheduler().now < end)
+            step(*emu, transfer);
+
+        const std::string& data = static_cast<BufferSerialSink*>(emu->get_serial().get_sink())->data;
+        bool passed = true;
+        passed &= check(name, data == std::string(1, '\x5A'), "buffer holds " + std::to_string(data.size()) + " bytes");
+        passed &= check(name, emu->get_bus().bus_read(0xFF01) == 0xFF, "SB not 0xFF after the transfer");
+        passed &= check(name, took_transfer_cycles(transfer),
+                        "transfer took " + std::to_string(transfer.done - transfer.started) + " T-cycles");
+        return passed;
+    }
+}
+
+int main()
+{
+    struct Case
+    {
+        std::string name;
+        bool passed;
+    };
+    const std::vector<Case> cases = {
+        {"link_exchange", run_link("link_exchange", 0x80)},
+        {"link_slave_not_armed", run_link("link_slave_not_armed", 0x00)},
+        {"buffer_sink", run_buffer("buffer_sink")},
+    };
+    int failed = 0;
+    for (const Case& c : cases) {
+        std::cout << (c.passed ? "✓ " : "✗ ") << c.name << std::endl;
+        failed += c.passed ? 0 : 1;
+    }
+    std::cout << "\n" << cases.size() - failed << "/" << cases.size() << " serial cases passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -15,7 +15,7 @@ void CpuTestHelper::setInitialState(Cpu& cpu, Bus& bus, const Json::Value& testC
     cpu.regs.c = static_cast<uint8_t>(initial["c"].asUInt());
     cpu.regs.d = static_cast<uint8_t>(initial["d"].asUInt());
     cpu.regs.e = static_cast<uint8_t>(initial["e"].asUInt());
-    cpu.regs.f = static_cast<uint8_t>(initial["f"].asUInt());
+    cpu.write_f(static_cast<uint8_t>(initial["f"].asUInt()));
     cpu.regs.h = static_cast<uint8_t>(initial["h"].asUInt());
     cpu.regs.l = static_cast<uint8_t>(initial["l"].asUInt());
     
@@ -92,9 +92,9 @@ bool CpuTestHelper::verifyFinalState(Cpu& cpu, Bus& bus, const Json::Value& test
     }
     
     // Check F
-    if (cpu.regs.f != static_cast<uint8_t>(expected["f"].asUInt())) {
+    if (cpu.read_f() != static_cast<uint8_t>(expected["f"].asUInt())) {
         std::cerr << "  F mismatch: expected 0x" << std::hex << std::setw(2) << std::setfill('0')
-                  << expected["f"].asUInt() << ", got 0x" << static_cast<int>(cpu.regs.f) << std::dec << std::endl;
+                  << expected["f"].asUInt() << ", got 0x" << static_cast<int>(cpu.read_f()) << std::dec << std::endl;
         success = false;
     }
     
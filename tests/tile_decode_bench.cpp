@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "tile_decode.h"
+
+// Microbenchmark for the 2bpp tile row kernels: checks every kernel against the scalar one, then times them
+// decoding all of tile data (384 tiles, 3072 rows) in batches of 1, 2, 4, 8 and 21 rows with palette mapping.
+// 21 rows is one scanline's worth of BG tiles, 8 rows is a whole tile as the tile viewer decodes it.
+// With --check it stops after the cross-check, which is how ctest runs it
+
+namespace {
+    constexpr int ROWS = 384 * 8;
+    constexpr int PASSES = 2000;
+    constexpr uint8_t PALETTE = 0xE4;
+
+    const TileDecodeKernel KERNELS[] = { TileDecodeKernel::SCALAR, TileDecodeKernel::SSE2, TileDecodeKernel::AVX2 };
+
+    // Per-bit extraction as the PPU did it before the kernels, one pixel at a time
+    void decode_per_bit(const uint8_t* planes, int rows, uint8_t* ids, uint8_t* shades, uint8_t palette)
+    {
+        for (int row = 0; row < rows; row++)
+        {
+            for (int pixel = 0; pixel < 8; pixel++)
+            {
+                uint8_t bit_index = 7 - pixel;
+                uint8_t color_bit0 = (planes[row * 2] >> bit_index) & 0x01;
+                uint8_t color_bit1 = (planes[row * 2 + 1] >> bit_index) & 0x01;
+                uint8_t color_id = (color_bit1 << 1) | color_bit0;
+                ids[row * 8 + pixel] = color_id;
+                shades[row * 8 + pixel] = (palette >> (color_id * 2)) & 0x03;
+            }
+        }
+    }
+
+    template <typename Decode>
+    double time_ns_per_row(int batch, std::vector<uint8_t>& ids, std::vector<uint8_t>& shades, const std::vector<uint8_t>& planes, Decode decode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < PASSES; pass++)
+        {
+            for (int row = 0; row + batch <= ROWS; row += batch)
+                decode(planes.data() + row * 2, batch, ids.data() + row * 8, shades.data() + row * 8, static_cast<uint8_t>(PALETTE + pass));
+        }
+        auto end = std::chrono::steady_clock::now();
+        int rows_per_pass = ROWS / batch * batch;
+        return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(PASSES) * rows_per_pass);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool check_only = argc > 1 && std::string(argv[1]) == "--check";
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> planes(ROWS * 2);
+    for (uint8_t& byte : planes)
+        byte = static_cast<uint8_t>(rng());
+
+    // Every kernel must match the scalar one, for each batch size including the leftovers after the vector loop
+    std::vector<uint8_t> expected_ids(ROWS * 8), expected_shades(ROWS * 8), ids(ROWS * 8), shades(ROWS * 8);
+    set_tile_decode_kernel(TileDecodeKernel::SCALAR);
+    decode_tile_rows(planes.data(), ROWS, expected_ids.data(), expected_shades.data(), 0x1B);
+    for (TileDecodeKernel kernel : KERNELS)
+    {
+        if (!set_tile_decode_kernel(kernel))
+            continue;
+        for (int batch = 1; batch <= 7; batch++)
+        {
+            std::fill(ids.begin(), ids.end(), 0xFF);
+            std::fill(shades.begin(), shades.end(), 0xFF);
+            int row = 0;
+            for (; row + batch <= ROWS; row += batch)
+                decode_tile_rows(planes.data() + row * 2, batch, ids.data() + row * 8, shades.data() + row * 8, 0x1B);
+            int checked = row * 8;
+            if (!std::equal(ids.begin(), ids.begin() + checked, expected_ids.begin()) ||
+                !std::equal(shades.begin(), shades.begin() + checked, expected_shades.begin()))
+            {
+                std::cerr << tile_decode_kernel_name(kernel) << " kernel disagrees with scalar at batch " << batch << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (check_only)
+    {
+        std::cout << "All supported kernels match the scalar kernel" << std::endl;
+        return 0;
+    }
+
+    const int BATCHES[] = { 1, 2, 4, 8, 21 };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "ns per tile row (8 pixels, IDs and shades)" << std::endl;
+    std::cout << std::setw(10) << "kernel";
+    for (int batch : BATCHES)
+        std::cout << std::setw(10) << (std::to_string(batch) + " rows");
+    std::cout << std::endl;
+
+    std::vector<double> baseline;
+    std::cout << std::setw(10) << "per-bit";
+    for (int batch : BATCHES)
+    {
+        baseline.push_back(time_ns_per_row(batch, ids, shades, planes, decode_per_bit));
+        std::cout << std::setw(10) << baseline.back();
+    }
+    std::cout << std::endl;
+
+    for (TileDecodeKernel kernel : KERNELS)
+    {
+        if (!set_tile_decode_kernel(kernel))
+        {
+            std::cout << std::setw(10) << tile_decode_kernel_name(kernel) << "  not supported on this host" << std::endl;
+            continue;
+        }
+        std::cout << std::setw(10) << tile_decode_kernel_name(kernel);
+        std::vector<double> speedups;
+        for (size_t i = 0; i < std::size(BATCHES); i++)
+        {
+            double ns = time_ns_per_row(BATCHES[i], ids, shades, planes, decode_tile_rows);
+            speedups.push_back(baseline[i] / ns);
+            std::cout << std::setw(10) << ns;
+        }
+        std::cout << "   speedup";
+        for (double speedup : speedups)
+            std::cout << ' ' << speedup << 'x';
+        std::cout << std::endl;
+    }
+    return 0;
+}